@@ -0,0 +1,353 @@
+/* `````````````````````````````````````````````````````````````````````
+ * Allocator Stress Benchmark
+ *
+ * Drives umalloc/ufree with synthetic allocation patterns, so the
+ * allocators can be compared without the file reading and tree work of
+ * the Huffman runs mixed in. Each allocator gets its own executable, see
+ * ubackend.h for how one is picked.
+ *
+ * Patterns:
+ *   lifo      allocate a batch, free it newest first
+ *   fifo      allocate a batch, free it oldest first
+ *   random    random sizes with random lifetimes in a window of slots
+ *   prodcons  even threads allocate, the odd thread next to them frees
+ *   huffman   what one block takes, sized from huffman.h: a MinHeap, its
+ *             array of SYMBOLS Node pointers, a BLOCK_SIZE buffer and a
+ *             tree of Nodes, with a pool reset before each block the way
+ *             exec_pool.c calls umem_block_start
+ *
+ * For each pattern and thread count (1, 2, 4, ... up to -t) it prints
+ * operations per second, the median and 99th percentile latency of a
+ * sample of single umalloc/ufree calls, the most bytes live at once,
+ * the process's peak RSS so far, and how many allocations failed.
+ *
+ * Usage: allocbench [-t max_threads] [-n ops_per_thread] [-p pattern]
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "huffman.h"
+#include "ubackend.h"
+
+#define MAX_THREADS 64
+#define WINDOW 32                 // live objects per thread in the batch and random patterns
+#define SAMPLE_EVERY 64           // time one call in this many
+#define MAX_SAMPLES 65536         // per thread
+#define QUEUE_SIZE 256            // producer/consumer handoff ring
+
+typedef enum { LIFO, FIFO, RANDOM, PRODCONS, HUFFMAN, NUM_PATTERNS } pattern_t;
+
+static const char *pattern_names[NUM_PATTERNS] = { "lifo", "fifo", "random", "prodcons", "huffman" };
+
+// Single producer, single consumer ring of pointers between two threads
+typedef struct {
+    _Alignas(64) _Atomic unsigned long head;
+    _Alignas(64) _Atomic unsigned long tail;
+    void *slots[QUEUE_SIZE];
+} queue_t;
+
+typedef struct {
+    _Alignas(64) int id;
+    int num_threads;
+    pattern_t pattern;
+    long ops;                 // operations to do
+    unsigned long rng;
+    queue_t *queue;           // shared with the partner in prodcons
+    _Atomic int *producer_done;
+
+    long done;                // umalloc and ufree calls made
+    long failed;              // umalloc calls that returned NULL
+    long live;                // bytes this thread has live right now
+    long peak_live;
+    int num_samples;
+    unsigned *samples;        // nanoseconds per sampled call
+} bench_thread_t;
+
+static unsigned long next_random(bench_thread_t *t) {
+    // xorshift64, plenty for picking sizes and slots
+    t->rng ^= t->rng << 13;
+    t->rng ^= t->rng >> 7;
+    t->rng ^= t->rng << 17;
+    return t->rng;
+}
+
+static long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+// Every call goes through these two so counting and sampling are the same for all patterns
+static void *timed_alloc(bench_thread_t *t, size_t size) {
+    void *p;
+    if (t->done++ % SAMPLE_EVERY == 0 && t->num_samples < MAX_SAMPLES) {
+        long start = now_ns();
+        p = bench_alloc(size);
+        t->samples[t->num_samples++] = (unsigned)(now_ns() - start);
+    } else {
+        p = bench_alloc(size);
+    }
+
+    if (!p) {
+        t->failed++;
+        return NULL;
+    }
+    // Touch it like a real caller would, which is also what makes footprint show up in RSS
+    memset(p, 0xAB, size < 64 ? size : 64);
+    t->live += size;
+    if (t->live > t->peak_live)
+        t->peak_live = t->live;
+    return p;
+}
+
+static void timed_free(bench_thread_t *t, void *p, size_t size) {
+    if (!p)
+        return;
+    t->live -= size;
+    if (t->done++ % SAMPLE_EVERY == 0 && t->num_samples < MAX_SAMPLES) {
+        long start = now_ns();
+        bench_free(p);
+        t->samples[t->num_samples++] = (unsigned)(now_ns() - start);
+    } else {
+        bench_free(p);
+    }
+}
+
+static size_t small_size(bench_thread_t *t) {
+    return 16 + next_random(t) % 241;   // 16..256
+}
+
+static void run_batches(bench_thread_t *t, int newest_first) {
+    void *ptrs[WINDOW];
+    size_t sizes[WINDOW];
+    while (t->done < t->ops) {
+        for (int i = 0; i < WINDOW; i++) {
+            sizes[i] = small_size(t);
+            ptrs[i] = timed_alloc(t, sizes[i]);
+        }
+        for (int i = 0; i < WINDOW; i++) {
+            int k = newest_first ? WINDOW - 1 - i : i;
+            timed_free(t, ptrs[k], sizes[k]);
+        }
+    }
+}
+
+static void run_random(bench_thread_t *t) {
+    void *ptrs[WINDOW] = { 0 };
+    size_t sizes[WINDOW] = { 0 };
+    while (t->done < t->ops) {
+        int k = next_random(t) % WINDOW;
+        if (ptrs[k]) {
+            timed_free(t, ptrs[k], sizes[k]);
+            ptrs[k] = NULL;
+        } else {
+            sizes[k] = small_size(t);
+            ptrs[k] = timed_alloc(t, sizes[k]);
+        }
+    }
+    for (int k = 0; k < WINDOW; k++)
+        timed_free(t, ptrs[k], sizes[k]);
+}
+
+// Objects cross threads, so every free is one the allocating thread didn't make. Sizes are fixed so the consumer
+// knows what it is freeing without a side channel.
+#define PRODCONS_SIZE 64
+
+static void run_producer(bench_thread_t *t) {
+    queue_t *q = t->queue;
+    while (t->done < t->ops) {
+        void *p = timed_alloc(t, PRODCONS_SIZE);
+        if (!p)
+            continue;
+        t->live -= PRODCONS_SIZE;   // the consumer owns it now
+        unsigned long tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        while (tail - atomic_load_explicit(&q->head, memory_order_acquire) == QUEUE_SIZE)
+            sched_yield();   // full, let the consumer run
+        q->slots[tail % QUEUE_SIZE] = p;
+        atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    }
+    atomic_store(t->producer_done, 1);
+}
+
+static void run_consumer(bench_thread_t *t) {
+    queue_t *q = t->queue;
+    while (1) {
+        unsigned long head = atomic_load_explicit(&q->head, memory_order_relaxed);
+        if (head == atomic_load_explicit(&q->tail, memory_order_acquire)) {
+            if (atomic_load(t->producer_done) && head == atomic_load(&q->tail))
+                break;
+            sched_yield();
+            continue;
+        }
+        void *p = q->slots[head % QUEUE_SIZE];
+        atomic_store_explicit(&q->head, head + 1, memory_order_release);
+        t->live += PRODCONS_SIZE;
+        timed_free(t, p, PRODCONS_SIZE);
+    }
+}
+
+// With nobody to hand to, a lone thread frees its own objects one step behind
+static void run_prodcons_alone(bench_thread_t *t) {
+    while (t->done < t->ops)
+        timed_free(t, timed_alloc(t, PRODCONS_SIZE), PRODCONS_SIZE);
+}
+
+static void run_huffman(bench_thread_t *t) {
+    enum { MAX_NODES = 511 };
+    void *nodes[MAX_NODES];
+    while (t->done < t->ops) {
+        bench_pool_reset();
+        void *buf = timed_alloc(t, BLOCK_SIZE);
+        void *heap = timed_alloc(t, sizeof(MinHeap));
+        void *array = timed_alloc(t, sizeof(Node *) * SYMBOLS);
+        // Anywhere from a block of a few digits to a block of random bytes
+        int count = 21 + next_random(t) % (MAX_NODES - 20);
+        for (int i = 0; i < count; i++)
+            nodes[i] = timed_alloc(t, sizeof(Node));
+        timed_free(t, array, sizeof(Node *) * SYMBOLS);
+        timed_free(t, heap, sizeof(MinHeap));
+        for (int i = count - 1; i >= 0; i--)
+            timed_free(t, nodes[i], sizeof(Node));
+        timed_free(t, buf, BLOCK_SIZE);
+    }
+}
+
+static void *bench_thread(void *arg) {
+    bench_thread_t *t = arg;
+    bench_thread_init(t->id, t->num_threads);
+
+    switch (t->pattern) {
+        case LIFO: run_batches(t, 1); break;
+        case FIFO: run_batches(t, 0); break;
+        case RANDOM: run_random(t); break;
+        case PRODCONS:
+            if (!t->queue)
+                run_prodcons_alone(t);
+            else if (t->id % 2 == 0)
+                run_producer(t);
+            else
+                run_consumer(t);
+            break;
+        case HUFFMAN: run_huffman(t); break;
+        default: break;
+    }
+    return NULL;
+}
+
+static int compare_unsigned(const void *a, const void *b) {
+    unsigned x = *(const unsigned *)a, y = *(const unsigned *)b;
+    return (x > y) - (x < y);
+}
+
+static void run_pattern(pattern_t pattern, int num_threads, long ops) {
+    bench_thread_t *threads = calloc(num_threads, sizeof(bench_thread_t));
+    queue_t *queues = calloc((num_threads + 1) / 2, sizeof(queue_t));
+    _Atomic int *done_flags = calloc((num_threads + 1) / 2, sizeof(_Atomic int));
+    pthread_t tids[MAX_THREADS];
+
+    for (int i = 0; i < num_threads; i++) {
+        bench_thread_t *t = &threads[i];
+        t->id = i;
+        t->num_threads = num_threads;
+        t->pattern = pattern;
+        t->ops = ops;
+        t->rng = 0x9E3779B97F4A7C15UL * (i + 1);
+        t->samples = malloc(sizeof(unsigned) * MAX_SAMPLES);
+        // Pairs (0,1), (2,3)... share a queue, a thread without a partner works alone
+        if (pattern == PRODCONS && (i ^ 1) < num_threads) {
+            t->queue = &queues[i / 2];
+            t->producer_done = &done_flags[i / 2];
+        }
+    }
+
+    long start = now_ns();
+    int started = 0;
+    for (; started < num_threads; started++) {
+        if (pthread_create(&tids[started], NULL, bench_thread, &threads[started])) {
+            perror("pthread_create");
+            break;
+        }
+    }
+    for (int i = 0; i < started; i++)
+        pthread_join(tids[i], NULL);
+    double seconds = (now_ns() - start) / 1e9;
+
+    long total_ops = 0, failed = 0, peak_live = 0, total_samples = 0;
+    for (int i = 0; i < started; i++) {
+        total_ops += threads[i].done;
+        failed += threads[i].failed;
+        peak_live += threads[i].peak_live;   // each thread's peak, so an upper bound on the peak all together
+        total_samples += threads[i].num_samples;
+    }
+
+    unsigned *samples = malloc(sizeof(unsigned) * (total_samples ? total_samples : 1));
+    long n = 0;
+    for (int i = 0; i < started; i++) {
+        memcpy(samples + n, threads[i].samples, sizeof(unsigned) * threads[i].num_samples);
+        n += threads[i].num_samples;
+    }
+    qsort(samples, n, sizeof(unsigned), compare_unsigned);
+    unsigned p50 = n ? samples[n / 2] : 0;
+    unsigned p99 = n ? samples[n * 99 / 100] : 0;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("%-9s %7d %14.0f %9u %9u %11ld %9ld %8ld\n", pattern_names[pattern], started, total_ops / seconds, p50, p99,
+           peak_live / 1024, usage.ru_maxrss, failed);
+
+    for (int i = 0; i < num_threads; i++)
+        free(threads[i].samples);
+    free(samples);
+    free(done_flags);
+    free(queues);
+    free(threads);
+}
+
+int main(int argc, char *argv[]) {
+    int max_threads = 8;
+    long ops = 200000;
+    int only = -1;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            max_threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            ops = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+            const char *name = argv[++i];
+            for (int p = 0; p < NUM_PATTERNS; p++)
+                if (!strcmp(name, pattern_names[p]))
+                    only = p;
+            if (only < 0) {
+                fprintf(stderr, "Unknown pattern %s\n", name);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Usage: %s [-t max_threads] [-n ops_per_thread] [-p lifo|fifo|random|prodcons|huffman]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (max_threads < 1)
+        max_threads = 1;
+    if (max_threads > MAX_THREADS)
+        max_threads = MAX_THREADS;
+
+    bench_init();
+
+    printf("%-9s %7s %14s %9s %9s %11s %9s %8s\n", "pattern", "threads", "ops/sec", "p50 ns", "p99 ns", "peak live KB", "rss KB", "failed");
+    for (int p = 0; p < NUM_PATTERNS; p++) {
+        if (only >= 0 && p != only)
+            continue;
+        for (int threads = 1; threads <= max_threads; threads *= 2)
+            run_pattern(p, threads, ops);
+    }
+    return 0;
+}
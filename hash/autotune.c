@@ -0,0 +1,249 @@
+/* `````````````````````````````````````````````````````````````````````
+ * Automatic Mode Selection
+ *
+ *     <binary> <file> --auto
+ *
+ * Picks single or parallel execution, and how many workers, from what
+ * the file will cost to hash on this machine against what the executor
+ * linked in costs to start:
+ *
+ *   single        blocks * block cost
+ *   per worker    workers * thread start + blocks * block cost / workers
+ *   per block     blocks * (thread or process) start
+ *                   + blocks * block cost / cores
+ *
+ * A block's cost is almost all tree building, and the tree has a node
+ * per distinct symbol. Blocks of SMALL_SYMBOLS or fewer build theirs on
+ * the stack (see huffman.c) at a flat cost, bigger ones are timed at
+ * FEW_SYMBOLS and at 256, and a block in between costs what the line
+ * between the two timings either side of it says. Every point is a
+ * measured time, so unlike a fitted a + b * symbols no block can come
+ * out at a negative cost. These and the thread and process start costs
+ * come from a calibration run on synthetic blocks, saved in a profile
+ * file ($HASH_PROFILE, or ~/.hash_profile, plus the backend's name,
+ * since the trees' cost is mostly its umalloc) so later runs skip it;
+ * delete the file to recalibrate, which also happens when the core
+ * count changes. Every run then only counts symbols in a few blocks
+ * sampled across the file.
+ *
+ * BLOCK_SIZE stays fixed, since the signature is defined by it.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "huffman.h"
+#include "umem.h"
+
+#define PROFILE_NAME ".hash_profile"
+#define SAMPLES 16   // blocks counted to estimate the file's cost
+#define FEW_SYMBOLS 32   // well clear of SMALL_SYMBOLS, so it times the umalloc'd tree
+
+typedef struct {
+    long cpus;
+    double small_ns;    // a block of SMALL_SYMBOLS or fewer distinct symbols
+    double few_ns;      // a block of FEW_SYMBOLS
+    double many_ns;     // a block of all SYMBOLS
+    double thread_ns;   // pthread_create and join of a thread that does nothing
+    double fork_ns;     // fork, exit and waitpid of a child that does nothing
+} profile_t;
+
+static double now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static void profile_path(char *path, size_t len) {
+    const char *env = getenv("HASH_PROFILE");
+    const char *home = getenv("HOME");
+    if (env)
+        snprintf(path, len, "%s.%s", env, umem_name);
+    else if (home)
+        snprintf(path, len, "%s/%s.%s", home, PROFILE_NAME, umem_name);
+    else
+        snprintf(path, len, "%s.%s", PROFILE_NAME, umem_name);
+}
+
+static int profile_load(const char *path, profile_t *p) {
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return 0;
+    char key[32];
+    double value;
+    int found = 0;
+    while (fscanf(fp, "%31s %lf", key, &value) == 2) {
+        if (!strcmp(key, "cpus"))
+            p->cpus = (long)value, found |= 1;
+        else if (!strcmp(key, "few_ns"))
+            p->few_ns = value, found |= 2;
+        else if (!strcmp(key, "many_ns"))
+            p->many_ns = value, found |= 4;
+        else if (!strcmp(key, "thread_ns"))
+            p->thread_ns = value, found |= 8;
+        else if (!strcmp(key, "fork_ns"))
+            p->fork_ns = value, found |= 16;
+        else if (!strcmp(key, "small_ns"))
+            p->small_ns = value, found |= 32;
+    }
+    fclose(fp);
+    return found == 63;
+}
+
+static void profile_save(const char *path, const profile_t *p) {
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return;   // no profile just means calibrating again next time
+    fprintf(fp, "cpus %ld\nsmall_ns %.0f\nfew_ns %.0f\nmany_ns %.0f\nthread_ns %.0f\nfork_ns %.0f\n", p->cpus,
+            p->small_ns, p->few_ns, p->many_ns, p->thread_ns, p->fork_ns);
+    fclose(fp);
+}
+
+/* =======================================================================
+   Calibration
+   ======================================================================= */
+
+// Average time to hash a block with symbols distinct symbols
+static double time_block(int symbols, int reps) {
+    unsigned char block[BLOCK_SIZE];
+    for (int i = 0; i < BLOCK_SIZE; i++)
+        block[i] = (unsigned char)(i % symbols);
+    volatile unsigned long sink = process_block(block, BLOCK_SIZE);   // warm up
+    double start = now_ns();
+    for (int r = 0; r < reps; r++)
+        sink += process_block(block, BLOCK_SIZE);
+    (void)sink;
+    return (now_ns() - start) / reps;
+}
+
+static void *idle_thread(void *arg) {
+    return arg;
+}
+
+static double time_thread(int reps) {
+    double start = now_ns();
+    for (int r = 0; r < reps; r++) {
+        pthread_t t;
+        if (pthread_create(&t, NULL, idle_thread, NULL) == 0)
+            pthread_join(t, NULL);
+    }
+    return (now_ns() - start) / reps;
+}
+
+static double time_fork(int reps) {
+    double start = now_ns();
+    for (int r = 0; r < reps; r++) {
+        pid_t pid = fork();
+        if (pid == 0)
+            _exit(0);
+        if (pid > 0)
+            waitpid(pid, NULL, 0);
+    }
+    return (now_ns() - start) / reps;
+}
+
+static void calibrate(profile_t *p) {
+    p->small_ns = time_block(SMALL_SYMBOLS, 200);
+    p->few_ns = time_block(FEW_SYMBOLS, 100);
+    p->many_ns = time_block(SYMBOLS, 50);
+    p->thread_ns = time_thread(32);
+    p->fork_ns = time_fork(16);
+}
+
+/* =======================================================================
+   Planning
+   ======================================================================= */
+
+// Cost of a block with symbols distinct symbols, between the timings either side of it
+static double block_cost(const profile_t *p, int symbols) {
+    if (symbols <= SMALL_SYMBOLS)
+        return p->small_ns;
+    if (symbols <= FEW_SYMBOLS)
+        return p->small_ns + (p->few_ns - p->small_ns) * (symbols - SMALL_SYMBOLS) / (FEW_SYMBOLS - SMALL_SYMBOLS);
+    return p->few_ns + (p->many_ns - p->few_ns) * (symbols - FEW_SYMBOLS) / (SYMBOLS - FEW_SYMBOLS);
+}
+
+// Average cost of a block, from the distinct symbols of blocks sampled evenly across the file
+static double sample_cost(int fd, long num_blocks, const profile_t *p) {
+    long samples = num_blocks < SAMPLES ? num_blocks : SAMPLES;
+    double total = 0;
+    for (long i = 0; i < samples; i++) {
+        unsigned char block[BLOCK_SIZE];
+        ssize_t n = pread(fd, block, BLOCK_SIZE, (off_t)(num_blocks * i / samples) * BLOCK_SIZE);
+        int seen[SYMBOLS] = { 0 };
+        int distinct = 0;
+        for (ssize_t j = 0; j < n; j++)
+            distinct += !seen[block[j]]++;
+        total += block_cost(p, distinct);
+    }
+    return samples ? total / samples : 0;
+}
+
+int run_auto(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror("open");
+        return 1;
+    }
+    long num_blocks = (st.st_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    char path[4096];
+    profile_t p;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1)
+        cpus = 1;
+    profile_path(path, sizeof(path));
+    if (!profile_load(path, &p) || p.cpus != cpus) {
+        calibrate(&p);
+        p.cpus = cpus;
+        profile_save(path, &p);
+    }
+
+    double cost = sample_cost(fd, num_blocks, &p);
+    close(fd);
+    double single = num_blocks * cost;
+
+    // The cheapest way to run the linked-in executor, if it takes the file at all, and whether it beats running single
+    int possible = 0;
+    double parallel = 0;
+    long workers = 0;
+    long cores = num_blocks < cpus ? num_blocks : cpus;
+    if (exec_info.max_blocks && num_blocks > exec_info.max_blocks)
+        possible = 0;   // it won't take the file at all
+    else if (exec_info.per_block) {
+        double start = exec_info.forks ? p.fork_ns : p.thread_ns;
+        parallel = num_blocks * start + single / (cores ? cores : 1);
+        possible = 1;
+    } else {
+        for (long w = 1; w <= cores; w++) {
+            double t = w * p.thread_ns + single / w;
+            if (!possible || t < parallel) {
+                parallel = t;
+                workers = w;
+                possible = 1;
+            }
+        }
+    }
+
+    int use_parallel = possible && parallel < single;
+#ifdef DEBUG
+    printf("auto: %ld blocks at %.0f ns, single %.2f ms, ", num_blocks, cost, single / 1e6);
+    if (possible)
+        printf("%s executor %.2f ms, running %s\n", exec_info.name, parallel / 1e6, use_parallel ? "parallel" : "single");
+    else
+        printf("%s executor can't take the file, running single\n", exec_info.name);
+#endif
+
+    if (!use_parallel)
+        return run_single(filename);
+    exec_workers = workers;
+    return run_threads(filename);
+}
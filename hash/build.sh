@@ -1,9 +1,17 @@
-echo esharedhash.c:
-gcc -pthread -Wall esharedhash.c -o b
+echo esharedhash:
+gcc -pthread -Wall -DUMEM_HAS_MEMALIGN main.c huffman.c autotune.c exec_pool.c umem_pools.c utrace.c -o b
 time ./b pi.txt -t
 
-echo sharedhash.c:
-gcc -pthread -Wall sharedhash.c -o a
+echo sharedhash:
+gcc -pthread -Wall main.c huffman.c autotune.c exec_threads.c umem_shared.c utrace.c -o a
 time ./a pi.txt -t
 
-rm a b
+echo sharedhash with TLSF:
+gcc -pthread -Wall main.c huffman.c autotune.c exec_threads.c umem_tlsf.c tlsf.c utrace.c -o c
+time ./c pi.txt -t
+
+echo sharedhash with adaptive locks:
+gcc -pthread -Wall -DULOCK_ADAPTIVE main.c huffman.c autotune.c exec_threads.c umem_shared.c utrace.c -o d
+time ./d pi.txt -t
+
+rm a b c d
@@ -0,0 +1,196 @@
+#include <pthread.h>
+
+#include "cdc.h"
+
+#define STRIPE (CDC_SEGMENT / CDC_LANES)
+#define STRICT 1   // low bit of a candidate: it passes the strict mask as well as the loose one
+
+_Static_assert(CDC_LANES == 4, "fill_lanes runs exactly four lanes");
+_Static_assert(CDC_SEGMENT * 2 <= 65536, "candidates are 16 bits");
+
+// The candidate cuts in one segment of the buffer, as position in the segment << 1 | STRICT, in order
+typedef struct {
+    const cdc_params *p;
+    const unsigned char *buf;
+    size_t len;
+    size_t seg;    // SIZE_MAX until the first segment is filled
+    size_t count;
+    size_t next;   // candidates before this one are behind every search still to come
+    uint16_t cand[CDC_SEGMENT];
+    uint16_t lane[CDC_LANES][STRIPE];
+} scan_t;
+
+static uint64_t gear[256];
+static pthread_once_t gear_once = PTHREAD_ONCE_INIT;
+
+// Any fixed table of random-looking words will do, these are splitmix64's from seed 0
+static void gear_init(void) {
+    uint64_t x = 0;
+    for (int i = 0; i < 256; i++) {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        gear[i] = z ^ (z >> 31);
+    }
+}
+
+// The top bits ones, as many as there are
+static uint64_t top_bits(int bits) {
+    return bits <= 0 ? 0 : bits >= 64 ? ~0ULL : ~0ULL << (64 - bits);
+}
+
+int cdc_init(cdc_params *p, size_t min, size_t avg, size_t max) {
+    if (min < CDC_MIN_SIZE || avg < min || max < avg)
+        return 0;
+    pthread_once(&gear_once, gear_init);
+
+    int bits = 0;
+    while ((2UL << bits) <= avg)
+        bits++;
+    p->min = min;
+    p->avg = avg;
+    p->max = max;
+    p->mask_strict = top_bits(bits + 1);
+    p->mask_loose = top_bits(bits - 1);
+    return 1;
+}
+
+/* =======================================================================
+   Candidates
+   -----------------------------------------------------------------------
+   The strict mask has every bit of the loose one and two more, so the
+   strict candidates are some of the loose ones. Both passes only test
+   the loose mask per byte, and tell the strict ones apart on the rare
+   loose hit.
+   ======================================================================= */
+
+static uint16_t candidate(const cdc_params *p, size_t pos, uint64_t h) {
+    return (uint16_t)(pos << 1 | !(h & p->mask_strict));
+}
+
+// The candidates in [seg, seg + n) one position at a time, for the short last segment
+static void fill_scalar(scan_t *sc, size_t seg, size_t n) {
+    uint64_t h = 0;
+    for (size_t i = seg >= 63 ? seg - 63 : 0; i < seg; i++)
+        h = (h << 1) + gear[sc->buf[i]];
+    sc->count = 0;
+    for (size_t i = 0; i < n; i++) {
+        h = (h << 1) + gear[sc->buf[seg + i]];
+        if (!(h & sc->p->mask_loose))
+            sc->cand[sc->count++] = candidate(sc->p, i, h);
+    }
+}
+
+// The candidates in a whole segment, a stripe of it in each of four lanes at once. Each lane is its own
+// shift-and-add chain, so the chains overlap in the pipeline (or share a vector register, on targets with gathers)
+// instead of each byte waiting for the one before it. Each lane first runs over the 63 bytes before its stripe,
+// which is all the history a window hash has.
+static void fill_lanes(scan_t *sc, size_t seg) {
+    const unsigned char *base = sc->buf + seg;
+    const unsigned char *p0 = base, *p1 = base + STRIPE, *p2 = base + 2 * STRIPE, *p3 = base + 3 * STRIPE;
+    uint64_t mask = sc->p->mask_loose;
+    uint64_t h0 = 0, h1 = 0, h2 = 0, h3 = 0;
+    for (long t = -63; t < 0; t++) {
+        h0 = (h0 << 1) + ((long)seg + t >= 0 ? gear[p0[t]] : 0);
+        h1 = (h1 << 1) + gear[p1[t]];
+        h2 = (h2 << 1) + gear[p2[t]];
+        h3 = (h3 << 1) + gear[p3[t]];
+    }
+
+    size_t n0 = 0, n1 = 0, n2 = 0, n3 = 0;
+    for (size_t t = 0; t < STRIPE; t++) {
+        h0 = (h0 << 1) + gear[p0[t]];
+        h1 = (h1 << 1) + gear[p1[t]];
+        h2 = (h2 << 1) + gear[p2[t]];
+        h3 = (h3 << 1) + gear[p3[t]];
+        if (__builtin_expect(!((h0 & mask) && (h1 & mask) && (h2 & mask) && (h3 & mask)), 0)) {
+            if (!(h0 & mask))
+                sc->lane[0][n0++] = candidate(sc->p, t, h0);
+            if (!(h1 & mask))
+                sc->lane[1][n1++] = candidate(sc->p, STRIPE + t, h1);
+            if (!(h2 & mask))
+                sc->lane[2][n2++] = candidate(sc->p, 2 * STRIPE + t, h2);
+            if (!(h3 & mask))
+                sc->lane[3][n3++] = candidate(sc->p, 3 * STRIPE + t, h3);
+        }
+    }
+
+    // Each lane's candidates come after the last lane's, so putting them in order is putting them end to end
+    size_t counts[CDC_LANES] = { n0, n1, n2, n3 };
+    sc->count = 0;
+    for (int k = 0; k < CDC_LANES; k++)
+        for (size_t i = 0; i < counts[k]; i++)
+            sc->cand[sc->count++] = sc->lane[k][i];
+}
+
+static void fill(scan_t *sc, size_t seg) {
+    size_t n = sc->len - seg < CDC_SEGMENT ? sc->len - seg : CDC_SEGMENT;
+    if (n == CDC_SEGMENT)
+        fill_lanes(sc, seg);
+    else
+        fill_scalar(sc, seg, n);
+    sc->seg = seg;
+    sc->next = 0;
+}
+
+// The first candidate in [from, to), strict ones only if strict is set, or to if there is none. from only ever moves
+// forward, so each segment is filled once and each candidate passed over once.
+static size_t find(scan_t *sc, int strict, size_t from, size_t to) {
+    while (from < to) {
+        size_t seg = from / CDC_SEGMENT * CDC_SEGMENT;
+        if (seg != sc->seg)
+            fill(sc, seg);
+        size_t lo = from - seg;
+        size_t hi = (to < seg + CDC_SEGMENT ? to : seg + CDC_SEGMENT) - seg;
+        while (sc->next < sc->count && (size_t)(sc->cand[sc->next] >> 1) < lo)
+            sc->next++;
+        for (size_t i = sc->next; i < sc->count && (size_t)(sc->cand[i] >> 1) < hi; i++)
+            if (!strict || (sc->cand[i] & STRICT))
+                return seg + (sc->cand[i] >> 1);
+        from = seg + hi;
+    }
+    return to;
+}
+
+/* =======================================================================
+   Cutting
+   ======================================================================= */
+
+size_t cdc_split(const cdc_params *p, const unsigned char *buf, size_t len, size_t *ends, size_t max_chunks) {
+    scan_t sc = { .p = p, .buf = buf, .len = len, .seg = (size_t)-1 };
+    size_t n = 0;
+    for (size_t s = 0; s < len && n < max_chunks; s = ends[n++]) {
+        if (len - s <= p->min) {
+            ends[n] = len;
+            continue;
+        }
+        size_t mid = len - s > p->avg ? s + p->avg : len;
+        size_t hi = len - s > p->max ? s + p->max : len;
+        size_t cut = find(&sc, 1, s + p->min, mid);
+        if (cut == mid)
+            cut = find(&sc, 0, mid, hi);
+        ends[n] = cut == hi ? hi : cut + 1;
+    }
+    return n;
+}
+
+size_t cdc_split_scalar(const cdc_params *p, const unsigned char *buf, size_t len, size_t *ends, size_t max_chunks) {
+    size_t n = 0;
+    for (size_t s = 0; s < len && n < max_chunks; s = ends[n++]) {
+        ends[n] = len;
+        if (len - s <= p->min)
+            continue;
+        size_t mid = len - s > p->avg ? s + p->avg : len;
+        size_t hi = len - s > p->max ? s + p->max : len;
+        ends[n] = hi;
+        uint64_t h = 0;
+        for (size_t i = s + p->min - 63; i < hi; i++) {
+            h = (h << 1) + gear[buf[i]];
+            if (i >= s + p->min && !(h & (i < mid ? p->mask_strict : p->mask_loose))) {
+                ends[n] = i + 1;
+                break;
+            }
+        }
+    }
+    return n;
+}
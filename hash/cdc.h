@@ -0,0 +1,60 @@
+#ifndef CDC_H
+#define CDC_H
+
+/* `````````````````````````````````````````````````````````````````````
+ * Content-Defined Chunking
+ *
+ * Cuts data into chunks where the content says to rather than every
+ * BLOCK_SIZE bytes, so an inserted or deleted byte only moves the
+ * boundaries next to it and every chunk after those comes out the same
+ * (and hashes the same) as before the edit.
+ *
+ * Every position i has a gear hash of the 64 bytes ending at it,
+ *
+ *     h(i) = sum over j < 64 of gear[buf[i - j]] << j   (mod 2^64)
+ *
+ * and is a candidate cut when the top bits of h(i) are all zero. A chunk
+ * starting at s ends after the first candidate in [s + min, s + max),
+ * or at s + max if there is none. Candidates before s + avg need one
+ * more zero bit than usual and those after one fewer (FastCDC's
+ * normalized chunking), which pulls chunk sizes in towards avg.
+ *
+ * Since min is at least 64, whether a chunk's end is a candidate never
+ * depends on bytes before the chunk, so cutting a buffer from any chunk
+ * boundary gives the same chunks as cutting it from the start.
+ *
+ * h(i) doesn't depend on where the chunk started either, so cdc_split
+ * finds candidates for a whole segment at a time instead of chunk by
+ * chunk: the segment is split into CDC_LANES stripes, each hashed by its
+ * own shift-and-add chain, and all the chains advance together a byte at
+ * a time. Instead of every byte waiting for the one before it, the
+ * chains overlap, and on targets with gathers (AVX2 and up) the compiler
+ * can put them in one vector register. Candidates are rare, one every
+ * avg / 2 bytes or so, so they go in a short sorted list, and picking
+ * the cuts is a walk along it.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CDC_MIN_SIZE 64          // the hash window, the smallest min that keeps chunks independent
+#define CDC_SEGMENT 16384        // bytes whose candidates are found in one pass
+#define CDC_LANES 4
+
+typedef struct {
+    size_t min, avg, max;
+    uint64_t mask_strict;   // before avg
+    uint64_t mask_loose;    // from avg on
+} cdc_params;
+
+// Returns 0 unless CDC_MIN_SIZE <= min <= avg <= max
+int cdc_init(cdc_params *p, size_t min, size_t avg, size_t max);
+
+// Cuts buf into chunks and stores where each one ends, up to max_chunks of them. Returns how many it stored; if
+// that's max_chunks and the last end isn't len, carry on from there with buf + that end.
+size_t cdc_split(const cdc_params *p, const unsigned char *buf, size_t len, size_t *ends, size_t max_chunks);
+
+// cdc_split one position at a time, to check the vector version against (hashchunks -x)
+size_t cdc_split_scalar(const cdc_params *p, const unsigned char *buf, size_t len, size_t *ends, size_t max_chunks);
+
+#endif
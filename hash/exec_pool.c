@@ -0,0 +1,278 @@
+/* `````````````````````````````````````````````````````````````````````
+ * Work-Stealing Pool Executor
+ *
+ * A fixed set of workers, one per core, each owning a deque of blocks to
+ * hash. Block costs vary a lot (a block of pi digits has about 11
+ * symbols, a block of random bytes up to 256 and a tree more than 20
+ * times bigger) so handing out an equal share up front leaves cores idle
+ * at the end. Instead a worker that runs dry steals half of somebody
+ * else's remaining blocks.
+ *
+ * Every deque only ever holds a contiguous range of block numbers, so
+ * the whole Chase-Lev deque fits in one atomic word: the owner takes
+ * blocks off the front of its range and thieves cut off the back half.
+ * Both sides CAS the same word, so a block can never be handed out
+ * twice, and the word is the entire state so ABA is harmless.
+ *
+ * Workers read their blocks straight out of the mapped file, and each
+ * block is a umem_block_start for the backend, so backends with pools
+ * can empty them between blocks.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "huffman.h"
+#include "umem.h"
+
+const exec_info_t exec_info = { "pool", 0, 0, 0 };
+long exec_workers;
+
+#define CACHE_LINE 64
+
+// The range is the only thing other workers write, so it sits on a cache line of its own. Everything after it is
+// only written by the worker itself and starts on the next line, and the whole struct is a whole number of lines,
+// so workers next to each other in the array never share one.
+typedef struct {
+    _Alignas(CACHE_LINE) _Atomic uint64_t range;   // begin in the low 32 bits, end in the high 32 bits
+    _Alignas(CACHE_LINE) int id;
+    int num_workers;
+    const unsigned char *data;
+    size_t data_len;
+#ifdef DEBUG
+    unsigned long *results;   // every block's hash, only needed to print them
+#endif
+    unsigned long hash;       // sum of this worker's block hashes
+    int blocks;               // blocks this worker hashed
+    int steals;               // successful steals
+    int stolen;               // blocks taken by those steals
+} worker_t;
+
+static uint64_t make_range(uint32_t begin, uint32_t end) {
+    return (uint64_t)end << 32 | begin;
+}
+
+static uint32_t range_begin(uint64_t range) {
+    return (uint32_t)range;
+}
+
+static uint32_t range_end(uint64_t range) {
+    return (uint32_t)(range >> 32);
+}
+
+// Takes the next block off the front of the worker's own range. Returns -1 when it's empty.
+static long take_block(worker_t *w) {
+    uint64_t r = atomic_load(&w->range);
+    while (range_begin(r) < range_end(r)) {
+        if (atomic_compare_exchange_weak(&w->range, &r, make_range(range_begin(r) + 1, range_end(r))))
+            return range_begin(r);
+    }
+    return -1;
+}
+
+// Looks for the worker with the most blocks left and moves the back half of its range (at least one block) into
+// the thief's empty deque. Returns 0 when there's nothing left anywhere.
+static int steal_blocks(worker_t *thief, worker_t *workers) {
+    while (1) {
+        worker_t *victim = NULL;
+        uint64_t seen = 0;
+        uint32_t most = 0;
+        for (int i = 1; i < thief->num_workers; i++) {
+            worker_t *w = &workers[(thief->id + i) % thief->num_workers];
+            uint64_t r = atomic_load(&w->range);
+            if (range_end(r) - range_begin(r) > most) {
+                most = range_end(r) - range_begin(r);
+                victim = w;
+                seen = r;
+            }
+        }
+        if (!victim)
+            return 0;
+
+        uint32_t mid = range_end(seen) - (most + 1) / 2;
+        if (atomic_compare_exchange_strong(&victim->range, &seen, make_range(range_begin(seen), mid))) {
+            // Nobody steals from an empty deque, so the thief is the only one writing its own range here
+            atomic_store(&thief->range, make_range(mid, range_end(seen)));
+            thief->steals++;
+            thief->stolen += range_end(seen) - mid;
+            return 1;
+        }
+        // Lost a race with the owner or another thief, look again
+    }
+}
+
+// Worker thread function hashes blocks until there are none left to take or steal
+void *worker_thread(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    worker_t *workers = w - w->id;
+
+    umem_thread_start(w->id, w->num_workers);
+
+    do {
+        long block;
+        while ((block = take_block(w)) >= 0) {
+            size_t offset = (size_t)block * BLOCK_SIZE;
+            size_t len = w->data_len - offset < BLOCK_SIZE ? w->data_len - offset : BLOCK_SIZE;
+
+            // Everything the last block allocated is dead by now, so a backend with pools can hand every block
+            // the whole pool instead of the pool filling up after a few blocks
+            umem_block_start();
+            unsigned long h = process_block(w->data + offset, len);
+#ifdef DEBUG
+            w->results[block] = h;
+#endif
+            w->hash = add_hash(w->hash, h);
+            w->blocks++;
+        }
+    } while (steal_blocks(w, workers));
+
+    umem_thread_finish();
+    return NULL;
+}
+
+// The worker array comes from the backend when it can align memory, so it's part of what the backend is measured on
+static worker_t *workers_alloc(long num_workers) {
+#ifdef UMEM_HAS_MEMALIGN
+    return umemalign(CACHE_LINE, sizeof(worker_t) * num_workers);
+#else
+    void *p = NULL;
+    return posix_memalign(&p, CACHE_LINE, sizeof(worker_t) * num_workers) == 0 ? p : NULL;
+#endif
+}
+
+static void workers_free(worker_t *workers) {
+#ifdef UMEM_HAS_MEMALIGN
+    ufree(workers);
+#else
+    free(workers);
+#endif
+}
+
+int run_threads(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("open");
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("fstat");
+        close(fd);
+        return 1;
+    }
+    size_t file_size = st.st_size;
+    if (file_size == 0) {
+        close(fd);
+        print_final(0);
+        return 0;
+    }
+
+    unsigned char *data = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    madvise(data, file_size, MADV_SEQUENTIAL);
+
+    long num_blocks = (file_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (num_blocks > UINT32_MAX) {
+        fprintf(stderr, "Error: file too large\n");
+        munmap(data, file_size);
+        return 1;
+    }
+
+    // One worker per core unless run_auto asked for fewer, and never more workers than blocks or thread ids
+    long num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_workers < 1)
+        num_workers = 1;
+    if (exec_workers > 0 && num_workers > exec_workers)
+        num_workers = exec_workers;
+    if (num_workers > num_blocks)
+        num_workers = num_blocks;
+    if (num_workers > UMEM_MAX_THREADS)
+        num_workers = UMEM_MAX_THREADS;
+    #ifdef DEBUG
+    printf("I need %ld threads\n", num_workers);
+    #endif
+
+    worker_t *workers = workers_alloc(num_workers);
+    pthread_t threads[UMEM_MAX_THREADS];
+    if (!workers) {
+        fprintf(stderr, "umalloc failed for %ld workers\n", num_workers);
+        munmap(data, file_size);
+        return 1;
+    }
+#ifdef DEBUG
+    unsigned long *results = umalloc(sizeof(unsigned long) * num_blocks);
+    if (!results) {
+        fprintf(stderr, "umalloc failed for %ld blocks\n", num_blocks);
+        munmap(data, file_size);
+        return 1;
+    }
+#endif
+
+    // Start everybody off with an equal contiguous share, stealing evens out whatever that gets wrong
+    for (long i = 0; i < num_workers; i++) {
+        worker_t *w = &workers[i];
+        memset(w, 0, sizeof(worker_t));
+        atomic_init(&w->range, make_range(num_blocks * i / num_workers, num_blocks * (i + 1) / num_workers));
+        w->id = i;
+        w->num_workers = num_workers;
+        w->data = data;
+        w->data_len = file_size;
+#ifdef DEBUG
+        w->results = results;
+#endif
+    }
+
+    // Spawn the threads in the loop, whatever doesn't get a thread gets stolen by the ones that did
+    long started = 0;
+    for (; started < num_workers; started++) {
+        int r = pthread_create(&threads[started], NULL, worker_thread, &workers[started]);
+        if (r) {
+            perror("pthread_create");
+            break;
+        }
+    }
+    if (started == 0) {
+        workers_free(workers);
+        munmap(data, file_size);
+        return 1;
+    }
+
+    // Waiting for all the threads to finish with pthread_join and add to total
+
+    unsigned long final_hash = 0;
+    for (long i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    umem_threads_done();
+    for (long i = 0; i < num_workers; i++)
+        final_hash = add_hash(final_hash, workers[i].hash);
+
+#ifdef DEBUG
+    for (long i = 0; i < num_blocks; i++)
+        print_intermediate(i, results[i], i);
+    ufree(results);
+#endif
+
+    int status = print_final(final_hash);
+    umem_report();
+#ifdef DEBUG
+	for (long i = 0; i < num_workers; i++)
+		printf("Worker %ld: %d blocks, %d steals (%d blocks)\n", i, workers[i].blocks, workers[i].steals, workers[i].stolen);
+#endif
+
+    workers_free(workers);
+    munmap(data, file_size);
+	return status;
+}
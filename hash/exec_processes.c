@@ -0,0 +1,123 @@
+/* `````````````````````````````````````````````````````````````````````
+ * Process-per-Block Executor
+ *
+ * The parent reads the file a block at a time and forks a child for
+ * each one. The child hashes its copy of the block with its copy of the
+ * heap and writes the hash to a pipe. Once every child is running, the
+ * parent reaps them in block order and adds up what they wrote.
+ *
+ * Nothing is shared after fork, so this is the one executor the
+ * non-thread-safe backends can run under.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "huffman.h"
+#include "umem.h"
+#include "utrace.h"
+
+const exec_info_t exec_info = { "processes", 1, 1, 0 };
+long exec_workers;
+
+typedef struct process_node {
+    pid_t pid;
+    int pipefd;
+    int block_num;
+    struct process_node *next;
+} process_node_t;
+
+int run_threads(const char *filename) {
+    // Open in binary
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        perror("Error opening file");
+        return 1;
+    }
+
+    unsigned char buf[BLOCK_SIZE];
+    unsigned long final_hash = 0;
+    int block_num = 0;
+    size_t bytesRead = 0;
+    process_node_t* list = NULL;
+
+    // Enqueue all of the processes
+    while ((bytesRead = fread(buf, 1, BLOCK_SIZE, file)) > 0) {
+        int pipefd[2];
+        if (pipe(pipefd) == -1) {
+            perror("Error creating pipe");
+            exit(1);
+        }
+
+        pid_t pid = fork();
+
+        if (pid < 0) {
+            perror("Error forking");
+            fclose(file);
+            exit(1);
+        }
+
+        if (pid == 0) {
+            // child
+            umem_fork_child();
+            close(pipefd[0]);
+            unsigned long hash = process_block(buf, bytesRead);
+            write(pipefd[1], &hash, sizeof(hash));
+
+            close(pipefd[1]);
+            // _exit() does not flush the stdio buffers the child inherited from the parent, or run the trace's
+            // atexit flush
+            utrace_flush();
+            _exit(0);
+        } else {
+            // parent
+            close(pipefd[1]);
+
+            // Add new node to the list for parralelism to let it run
+            process_node_t* new_node = umalloc(sizeof(process_node_t));
+            new_node->pid = pid;
+            new_node->block_num = block_num;
+            new_node->pipefd = pipefd[0];
+            new_node->next = NULL;
+
+            // insert into end of list to preserve order when traversing
+            if (list == NULL) {
+                list = new_node;
+            } else {
+                process_node_t* curr = list;
+                while (curr->next != NULL) {
+                    curr = curr->next;
+                }
+                curr->next = new_node;
+            }
+
+            block_num++;
+        }
+
+    }
+
+    process_node_t* curr = list;
+    while (curr) {
+        while (waitpid(curr->pid, NULL, 0) != curr->pid) {}
+
+        // read hash now that process is done
+        unsigned long hash = 0;
+        read(curr->pipefd, &hash, sizeof(hash));
+        close(curr->pipefd);
+
+        print_intermediate(curr->block_num, hash, curr->pid);
+        final_hash = add_hash(final_hash, hash);
+
+        process_node_t* next = curr->next;
+        ufree(curr);
+        curr = next;
+    }
+
+    fclose(file);
+
+    int status = print_final(final_hash);
+    umem_report();
+    return status;
+}
@@ -0,0 +1,99 @@
+/* `````````````````````````````````````````````````````````````````````
+ * Thread-per-Block Executor
+ *
+ * The main thread reads the file a block at a time, copies each block
+ * into a umalloc'd buffer and starts a thread to hash it. The thread
+ * frees the buffer, which makes every block a cross-thread free, and
+ * leaves its hash in a results array the main thread adds up in block
+ * order once everyone is joined. Files are limited to UMEM_MAX_THREADS blocks.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "huffman.h"
+#include "umem.h"
+
+const exec_info_t exec_info = { "threads", 1, 0, UMEM_MAX_THREADS };
+long exec_workers;
+
+// Worker thread function
+void *worker_thread(void *arg) {
+    thread_arg_t *targ = (thread_arg_t *)arg;
+    umem_thread_start(targ->block_id, UMEM_MAX_THREADS);
+    unsigned long h = process_block(targ->block_buf, targ->block_len);
+    ufree(targ->block_buf);
+    targ->results[targ->block_id].hash = h;
+    ufree(targ);
+    umem_thread_finish();
+    return NULL;
+}
+
+int run_threads(const char *filename) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        perror("fopen");
+        return 1;
+    }
+
+    unsigned char buf[BLOCK_SIZE];
+    unsigned long final_hash = 0;
+    static result_t results[UMEM_MAX_THREADS];
+    pthread_t threads[UMEM_MAX_THREADS];
+    int num_blocks = 0;
+
+    while (!feof(fp)) {
+        size_t n = fread(buf, 1, BLOCK_SIZE, fp);
+        if (n == 0) break;
+
+        if (num_blocks >= UMEM_MAX_THREADS) {
+            fprintf(stderr, "Error: file too large (max %d blocks)\n", UMEM_MAX_THREADS);
+            fclose(fp);
+            return 1;
+        }
+
+        unsigned char *block_buf = umalloc(n);
+        if (!block_buf) {
+            fprintf(stderr, "umalloc failed for block %d\n", num_blocks);
+            fclose(fp);
+            return 1;
+        }
+        memcpy(block_buf, buf, n);
+
+        thread_arg_t *args = umalloc(sizeof(thread_arg_t));
+        args->block_id = num_blocks;
+        args->block_buf = block_buf;
+        args->block_len = n;
+        args->results = results;
+        int r = pthread_create(&threads[num_blocks], NULL, worker_thread, args);
+
+        if (r) {
+            perror("pthread_create");
+            ufree(block_buf);
+            fclose(fp);
+            return 1;
+        }
+
+        num_blocks++;
+    }
+
+    fclose(fp);
+
+    // Waiting for all the threads to finish with pthread_join and add to total
+
+    for (int i = 0; i < num_blocks; i++) {
+        pthread_join(threads[i], NULL);
+        unsigned long h = results[i].hash;
+        print_intermediate(i, h, i);
+        final_hash = add_hash(final_hash, h);
+    }
+
+    // The workers freed their blocks back to this thread, let the backend take them back now rather than on the
+    // next umalloc
+    umem_threads_done();
+
+    int status = print_final(final_hash);
+    umem_report();
+    return status;
+}
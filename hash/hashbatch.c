@@ -0,0 +1,236 @@
+/* `````````````````````````````````````````````````````````````````````
+ * Batch Hashing
+ *
+ *     hashbatch [-j workers] [-w window] [path...]
+ *
+ * Prints a signature per file, the same one `sharedhash <file>` would,
+ * as "<signature>  <path>" lines in the order the files were named.
+ * Paths come from the arguments, or one per line on stdin when there are
+ * none or one of them is "-", and directories are walked recursively.
+ *
+ * Every file goes to one libhuffsig context, so allocator setup and
+ * thread creation happen once per run instead of once per file. The main
+ * thread keeps up to window files in flight: it reads the next file
+ * while the workers hash the ones before it, and only waits (hashing
+ * alongside the workers) when the window is full. Files too small to be
+ * worth splitting still run in parallel with each other, since the
+ * workers take blocks from whichever files are in flight.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "huffsig.h"
+
+#define DEFAULT_WINDOW 64
+#define READ_LIMIT (64 * 1024)   // files up to this size are read into the slot's buffer, bigger ones are mapped
+
+typedef struct {
+    huffsig_job job;
+    char *path;
+    unsigned char *buf;          // READ_LIMIT bytes, kept for the whole run
+    const unsigned char *data;   // buf, the mapping, or a bigger buffer for special files past READ_LIMIT
+    size_t len;
+    int mapped;
+    int grown;                   // data is a buffer of its own to free
+} slot_t;
+
+static huffsig_ctx *ctx;
+static slot_t *slots;
+static int window = DEFAULT_WINDOW;
+static long head, tail;   // slots in flight are [head, tail), modulo window
+static int status;
+
+// Waits for the oldest file in flight and prints its signature
+static void retire(void) {
+    slot_t *s = &slots[head++ % window];
+    unsigned long sig = huffsig_wait(ctx, &s->job);
+    if (sig == HUFFSIG_ERROR) {
+        fprintf(stderr, "%s: out of tree memory\n", s->path);
+        status = 1;
+    } else
+        printf("%lu  %s\n", sig, s->path);
+    if (s->mapped)
+        munmap((void *)s->data, s->len);
+    if (s->grown)
+        free((void *)s->data);
+    free(s->path);
+}
+
+// Reads or maps the whole file into the slot. Returns 0 and reports on failure.
+static int load(slot_t *s, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        close(fd);
+        return 0;
+    }
+
+    s->mapped = 0;
+    s->grown = 0;
+    s->len = 0;
+    s->data = s->buf;
+    if (st.st_size > READ_LIMIT) {
+        void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            return 0;
+        }
+        s->data = p;
+        s->len = st.st_size;
+        s->mapped = 1;
+        return 1;
+    }
+
+    // Small or special files: read until EOF, whatever fstat said, moving to a bigger buffer if READ_LIMIT fills up
+    unsigned char *buf = s->buf;
+    size_t cap = READ_LIMIT;
+    ssize_t n;
+    while (1) {
+        if (s->len == cap) {
+            unsigned char *p = realloc(s->grown ? buf : NULL, cap * 2);
+            if (!p) {
+                fprintf(stderr, "%s: %s\n", path, strerror(ENOMEM));
+                break;
+            }
+            if (!s->grown)
+                memcpy(p, buf, s->len);
+            buf = p;
+            cap *= 2;
+            s->grown = 1;
+        }
+        n = read(fd, buf + s->len, cap - s->len);
+        if (n == 0) {
+            close(fd);
+            s->data = buf;
+            return 1;
+        }
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            break;
+        }
+        s->len += n;
+    }
+    close(fd);
+    if (s->grown)
+        free(buf);
+    return 0;
+}
+
+static void hash_file(const char *path) {
+    if (tail - head == window)
+        retire();
+
+    slot_t *s = &slots[tail % window];
+    if (!load(s, path)) {
+        status = 1;
+        return;
+    }
+    s->path = strdup(path);
+    huffsig_submit(ctx, &s->job, s->data, s->len);
+    tail++;
+}
+
+static int walk_entry(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st;
+    (void)ftw;
+    if (type == FTW_F)
+        hash_file(path);
+    else if (type == FTW_DNR || type == FTW_NS) {
+        fprintf(stderr, "%s: can't read\n", path);
+        status = 1;
+    }
+    return 0;
+}
+
+static void hash_path(const char *path) {
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+        if (nftw(path, walk_entry, 64, FTW_PHYS) < 0) {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            status = 1;
+        }
+    } else
+        hash_file(path);
+}
+
+static void hash_stdin(void) {
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    while ((n = getline(&line, &cap, stdin)) > 0) {
+        if (line[n - 1] == '\n')
+            line[--n] = '\0';
+        if (n > 0)
+            hash_path(line);
+    }
+    free(line);
+}
+
+int main(int argc, char *argv[]) {
+    int workers = -1;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:w:")) != -1) {
+        switch (opt) {
+        case 'j':
+            workers = atoi(optarg);
+            break;
+        case 'w':
+            window = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-j workers] [-w window] [path...]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (window < 1)
+        window = 1;
+
+    ctx = huffsig_create(workers);
+    slots = calloc(window, sizeof(slot_t));
+    if (!ctx || !slots) {
+        fprintf(stderr, "%s: can't start\n", argv[0]);
+        return 1;
+    }
+    for (int i = 0; i < window; i++) {
+        slots[i].buf = malloc(READ_LIMIT);
+        if (!slots[i].buf) {
+            perror("malloc");
+            return 1;
+        }
+    }
+
+    if (optind == argc)
+        hash_stdin();
+    for (int i = optind; i < argc; i++) {
+        if (strcmp(argv[i], "-") == 0)
+            hash_stdin();
+        else
+            hash_path(argv[i]);
+    }
+    while (head < tail)
+        retire();
+
+    huffsig_destroy(ctx);
+    for (int i = 0; i < window; i++)
+        free(slots[i].buf);
+    free(slots);
+    return status;
+}
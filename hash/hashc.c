@@ -0,0 +1,380 @@
+/* `````````````````````````````````````````````````````````````````````
+ * hashd Client
+ *
+ *     hashc [-f | -d | -s | -r] [-n repeat] [-p depth] [-t producers] <socket> <file>...
+ *
+ * Asks hashd for each file's signature and prints "<signature>  <file>"
+ * lines, like hashbatch. How the file gets to the daemon:
+ *
+ *   (default)  its absolute path, and hashd opens it
+ *   -f         an open descriptor, passed with SCM_RIGHTS
+ *   -d         its bytes, inline in the request
+ *   -s         copied once into a memfd that hashd maps (HASHD_MAP),
+ *              then hashed from there (HASHD_REGION)
+ *   -r         copied once into the data area of an hring.h ring
+ *              (HASHD_RING), then submitted on the ring; -t submits
+ *              from that many threads at once, through the MPSC path
+ *
+ * -n sends every file's request repeat times and reports the latency
+ * and throughput on stderr. Up to depth requests are outstanding at
+ * once (default 32, 1 turns pipelining off). A ring's depth is its
+ * number of entries, rounded up to a power of two and at least 2.
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hashd.h"
+#include "hring.h"
+
+typedef struct {
+    const char *name;
+    char *path;          // absolute, for HASHD_PATH
+    unsigned char *data; // contents, for HASHD_DATA
+    size_t len;
+    uint32_t region;     // for HASHD_REGION
+    uint64_t offset;     // in the ring's data area, for HASHD_RING
+} file_t;
+
+// What each -r producer thread submits: every producers'th request from first on
+typedef struct {
+    hring_t *ring;
+    const file_t *files;
+    int num_files;
+    long first, total, step;
+} producer_t;
+
+static int mode = HASHD_PATH;
+
+static int write_all(int fd, const void *buf, size_t len) {
+    const unsigned char *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0)
+            return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+static int read_all(int fd, void *buf, size_t len) {
+    unsigned char *p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n <= 0)
+            return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+// Sends the header with passed_fd attached
+static int send_with_fd(int sock, const hashd_request *req, int passed_fd) {
+    char control[CMSG_SPACE(sizeof(int))] = { 0 };
+    struct iovec iov = { (void *)req, sizeof(*req) };
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(c), &passed_fd, sizeof(int));
+    return sendmsg(sock, &msg, 0) == (ssize_t)sizeof(*req);
+}
+
+static int send_request(int sock, const file_t *f, uint32_t id) {
+    hashd_request req = { .kind = mode, .id = id };
+    switch (mode) {
+    case HASHD_PATH:
+        req.len = strlen(f->path);
+        return write_all(sock, &req, sizeof(req)) && write_all(sock, f->path, req.len);
+    case HASHD_DATA:
+        req.len = f->len;
+        return write_all(sock, &req, sizeof(req)) && write_all(sock, f->data, f->len);
+    case HASHD_REGION:
+        req.region = f->region;
+        req.len = f->len;
+        return write_all(sock, &req, sizeof(req));
+    default: {
+        int fd = open(f->name, O_RDONLY);
+        if (fd < 0) {
+            perror(f->name);
+            return 0;
+        }
+        int ok = send_with_fd(sock, &req, fd);
+        close(fd);
+        return ok;
+    }
+    }
+}
+
+static unsigned char *read_file(const char *name, size_t *len) {
+    FILE *fp = fopen(name, "rb");
+    if (!fp)
+        return NULL;
+    size_t cap = 64 * 1024;
+    unsigned char *buf = malloc(cap);
+    *len = 0;
+    size_t n;
+    while (buf && (n = fread(buf + *len, 1, cap - *len, fp)) > 0) {
+        *len += n;
+        if (*len == cap)
+            buf = realloc(buf, cap *= 2);
+    }
+    fclose(fp);
+    return buf;
+}
+
+// Copies the file into a memfd, sealed so it can't shrink under hashd's mapping, and has hashd map it. Returns 0 on
+// failure.
+static int map_file(int sock, file_t *f) {
+    int fd = memfd_create("hashc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0 || !write_all(fd, f->data, f->len) || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK) < 0) {
+        perror("memfd");
+        return 0;
+    }
+    hashd_request req = { .kind = HASHD_MAP };
+    hashd_reply reply;
+    int ok = send_with_fd(sock, &req, fd) && read_all(sock, &reply, sizeof(reply));
+    close(fd);
+    if (!ok || reply.status) {
+        fprintf(stderr, "%s: can't map: %s\n", f->name, ok ? strerror(reply.status) : "connection lost");
+        return 0;
+    }
+    f->region = (uint32_t)reply.signature;
+    return 1;
+}
+
+static void *produce(void *arg) {
+    producer_t *p = arg;
+    for (long i = p->first; i < p->total; i += p->step) {
+        const file_t *f = &p->files[i % p->num_files];
+        while (hring_submit(p->ring, f->offset, f->len, i) < 0)
+            sched_yield();
+    }
+    return NULL;
+}
+
+static double elapsed(const struct timespec *start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void report(long total, double secs, uint64_t bytes) {
+    fprintf(stderr, "%ld requests in %.3f s: %.1f us each, %.0f per second", total, secs, secs * 1e6 / total,
+            total / secs);
+    if (bytes)
+        fprintf(stderr, ", %.1f MB/s", bytes / secs / 1e6);
+    fputc('\n', stderr);
+}
+
+// Lays the files out in a ring's data area, hands the ring to hashd and submits every request on it
+static int run_ring(int sock, file_t *files, int num_files, long repeat, long depth, int producers) {
+    uint32_t entries = HRING_MIN_ENTRIES;
+    while (entries < depth && entries < HRING_MAX_ENTRIES)
+        entries <<= 1;
+    uint64_t data_size = 0;
+    for (int i = 0; i < num_files; i++) {
+        files[i].offset = data_size;
+        data_size += (files[i].len + 63) & ~63UL;
+    }
+
+    // Sealed against shrinking, which hashd insists on before it maps the ring
+    int fd = memfd_create("hashc-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    uint64_t size = hring_size(entries, data_size);
+    void *region = fd < 0 || ftruncate(fd, size) < 0 || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK) < 0
+                       ? MAP_FAILED
+                       : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (region == MAP_FAILED) {
+        perror("ring");
+        return 1;
+    }
+    hring_t ring;
+    hring_init(&ring, region, entries, data_size);
+    for (int i = 0; i < num_files; i++)
+        memcpy(ring.data + files[i].offset, files[i].data, files[i].len);
+
+    hashd_request req = { .kind = HASHD_RING };
+    hashd_reply reply = { 0 };
+    if (!send_with_fd(sock, &req, fd) || !read_all(sock, &reply, sizeof(reply)) || reply.status) {
+        fprintf(stderr, "ring refused: %s\n", reply.status ? strerror(reply.status) : "connection lost");
+        return 1;
+    }
+    close(fd);
+
+    long total = repeat * num_files, submitted = 0, reaped = 0;
+    uint64_t bytes = 0;
+    int status = 0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    pthread_t threads[producers > 1 ? producers : 1];
+    producer_t args[producers > 1 ? producers : 1];
+    if (producers > 1) {
+        for (int i = 0; i < producers; i++) {
+            args[i] = (producer_t){ &ring, files, num_files, i, total, producers };
+            pthread_create(&threads[i], NULL, produce, &args[i]);
+        }
+        submitted = total;
+    }
+
+    while (reaped < total) {
+        // A single producer submits and reaps on the same thread
+        if (producers <= 1 && submitted < total) {
+            const file_t *f = &files[submitted % num_files];
+            if (hring_submit_sp(&ring, f->offset, f->len, submitted) == 0) {
+                submitted++;
+                continue;
+            }
+        }
+        uint64_t user_data, signature;
+        int32_t err;
+        if (!hring_reap(&ring, &user_data, &err, &signature)) {
+            hring_wait_cq(&ring, 100);
+            continue;
+        }
+        reaped++;
+        const file_t *f = &files[user_data % num_files];
+        bytes += f->len;
+        if (err) {
+            fprintf(stderr, "%s: %s\n", f->name, strerror(err));
+            status = 1;
+        } else if ((long)user_data < num_files)
+            printf("%lu  %s\n", (unsigned long)signature, f->name);
+    }
+    double secs = elapsed(&start);
+
+    if (producers > 1)
+        for (int i = 0; i < producers; i++)
+            pthread_join(threads[i], NULL);
+    hring_close(&ring);
+    if (repeat > 1)
+        report(total, secs, bytes);
+    munmap(region, size);
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    long repeat = 1;
+    long depth = 32;
+    int producers = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "fdsrn:p:t:")) != -1) {
+        switch (opt) {
+        case 'f':
+            mode = HASHD_FD;
+            break;
+        case 'd':
+            mode = HASHD_DATA;
+            break;
+        case 's':
+            mode = HASHD_REGION;
+            break;
+        case 'r':
+            mode = HASHD_RING;
+            break;
+        case 'n':
+            repeat = atol(optarg);
+            break;
+        case 'p':
+            depth = atol(optarg);
+            break;
+        case 't':
+            producers = atoi(optarg);
+            break;
+        default:
+            optind = argc;
+            break;
+        }
+    }
+    if (argc - optind < 2 || repeat < 1 || depth < 1) {
+        fprintf(stderr, "Usage: %s [-f | -d | -s | -r] [-n repeat] [-p depth] [-t producers] <socket> <file>...\n",
+                argv[0]);
+        return 1;
+    }
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strncpy(addr.sun_path, argv[optind], sizeof(addr.sun_path) - 1);
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0 || connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    int num_files = argc - optind - 1;
+    file_t *files = calloc(num_files, sizeof(file_t));
+    for (int i = 0; i < num_files; i++) {
+        file_t *f = &files[i];
+        f->name = argv[optind + 1 + i];
+        if (mode == HASHD_PATH && !(f->path = realpath(f->name, NULL))) {
+            perror(f->name);
+            return 1;
+        }
+        if (mode == HASHD_DATA || mode == HASHD_REGION || mode == HASHD_RING) {
+            if (!(f->data = read_file(f->name, &f->len))) {
+                perror(f->name);
+                return 1;
+            }
+            if (mode == HASHD_REGION && !map_file(sock, f))
+                return 1;
+        }
+    }
+
+    if (mode == HASHD_RING)
+        return run_ring(sock, files, num_files, repeat, depth, producers);
+
+    // Keep up to depth requests outstanding, replies come back in order
+    long total = repeat * num_files, sent = 0, received = 0;
+    int status = 0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (received < total) {
+        if (sent < total && sent - received < depth) {
+            if (!send_request(sock, &files[sent % num_files], (uint32_t)sent))
+                return 1;
+            sent++;
+            continue;
+        }
+        hashd_reply reply;
+        if (!read_all(sock, &reply, sizeof(reply))) {
+            fprintf(stderr, "connection lost\n");
+            return 1;
+        }
+        const file_t *f = &files[received % num_files];
+        if (reply.id != (uint32_t)received) {
+            fprintf(stderr, "reply %u out of order, expected %ld\n", reply.id, received);
+            return 1;
+        }
+        if (received++ >= num_files)
+            continue;
+        if (reply.status) {
+            fprintf(stderr, "%s: %s\n", f->name, strerror(reply.status));
+            status = 1;
+        } else
+            printf("%lu  %s\n", (unsigned long)reply.signature, f->name);
+    }
+    double secs = elapsed(&start);
+
+    if (repeat > 1)
+        report(total, secs, 0);
+
+    close(sock);
+    return status;
+}
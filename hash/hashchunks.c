@@ -0,0 +1,148 @@
+/* `````````````````````````````````````````````````````````````````````
+ * Content-Defined Chunk Signatures
+ *
+ *     hashchunks [-c min:avg:max] [-j workers] [-q] [-v] [-x] <file>
+ *
+ * Cuts the file into content-defined chunks (see cdc.h), hashes each
+ * one with process_block, and prints "<offset> <length> <hash>" for
+ * every chunk and then "<sum>  <file>", the chunk hashes added modulo
+ * LARGE_PRIME. -q prints just the sum. Chunk sizes default to
+ * 256:1024:8192, around the fixed BLOCK_SIZE.
+ *
+ * The sum is not the fixed-block signature the hash binaries print, the
+ * chunks are different blocks. What it buys is that after an edit only
+ * the chunks around it hash differently, so per-chunk hashes can be
+ * cached or deduplicated across versions of a file.
+ *
+ * With -v the time spent cutting and hashing goes to stderr. -x also
+ * cuts the file with cdc_split_scalar, the one-position-at-a-time
+ * reference, and fails if its cuts differ from cdc_split's.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cdc.h"
+#include "huffsig.h"
+
+// Cuts the buffer again with the scalar reference and compares. Returns 0 and reports the first difference if any.
+static int check_cuts(const unsigned char *data, size_t len, size_t min, size_t avg, size_t max, const size_t *ends,
+                      size_t n, size_t max_chunks) {
+    cdc_params p;
+    size_t *ref = malloc(sizeof(size_t) * max_chunks);
+    if (!ref || !cdc_init(&p, min, avg, max)) {
+        free(ref);
+        fprintf(stderr, "can't check cuts\n");
+        return 0;
+    }
+    size_t ref_n = cdc_split_scalar(&p, data, len, ref, max_chunks);
+    size_t i = 0;
+    while (i < n && i < ref_n && ends[i] == ref[i])
+        i++;
+    int same = i == n && i == ref_n;
+    if (!same)
+        fprintf(stderr, "chunk %zu ends at %zu, the scalar reference says %zu\n", i, i < n ? ends[i] : len,
+                i < ref_n ? ref[i] : len);
+    free(ref);
+    return same;
+}
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    size_t min = 256, avg = 1024, max = 8192;
+    int workers = -1, quiet = 0, verbose = 0, check = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:j:qvx")) != -1) {
+        switch (opt) {
+        case 'c':
+            if (sscanf(optarg, "%zu:%zu:%zu", &min, &avg, &max) != 3)
+                optind = argc;
+            break;
+        case 'j':
+            workers = atoi(optarg);
+            break;
+        case 'q':
+            quiet = 1;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        case 'x':
+            check = 1;
+            break;
+        default:
+            optind = argc;
+            break;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "Usage: %s [-c min:avg:max] [-j workers] [-q] [-v] [-x] <file>\n", argv[0]);
+        return 1;
+    }
+    const char *path = argv[optind];
+    if (min < 64 || avg < min || max < avg) {
+        fprintf(stderr, "%s: chunk sizes must be 64 <= min <= avg <= max\n", argv[0]);
+        return 1;
+    }
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        return 1;
+    }
+    size_t len = st.st_size;
+    const unsigned char *data = len ? mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0) : (void *)"";
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror(path);
+        return 1;
+    }
+
+    size_t max_chunks = len / min + 1;
+    size_t *ends = malloc(sizeof(size_t) * max_chunks);
+    unsigned long *hashes = malloc(sizeof(unsigned long) * max_chunks);
+    huffsig_ctx *ctx = huffsig_create(workers);
+    if (!ends || !hashes || !ctx) {
+        fprintf(stderr, "%s: can't start\n", argv[0]);
+        return 1;
+    }
+
+    double t0 = now();
+    size_t n = huffsig_cdc_split(data, len, min, avg, max, ends, max_chunks);
+    double t1 = now();
+    if (check && !check_cuts(data, len, min, avg, max, ends, n, max_chunks))
+        return 1;
+    unsigned long sum = huffsig_chunks(ctx, data, ends, n, hashes);
+    double t2 = now();
+    if (sum == HUFFSIG_ERROR) {
+        fprintf(stderr, "%s: out of tree memory\n", path);
+        return 1;
+    }
+
+    if (!quiet)
+        for (size_t i = 0; i < n; i++) {
+            size_t start = i ? ends[i - 1] : 0;
+            printf("%zu %zu %lu\n", start, ends[i] - start, hashes[i]);
+        }
+    printf("%lu  %s\n", sum, path);
+    if (verbose)
+        fprintf(stderr, "%zu chunks, %.0f bytes average: cut in %.1f ms (%.0f MB/s), hashed in %.1f ms (%.0f MB/s)\n",
+                n, n ? (double)len / n : 0, (t1 - t0) * 1e3, len / (t1 - t0) / 1e6, (t2 - t1) * 1e3,
+                len / (t2 - t1) / 1e6);
+
+    huffsig_destroy(ctx);
+    free(hashes);
+    free(ends);
+    return 0;
+}
@@ -0,0 +1,513 @@
+/* `````````````````````````````````````````````````````````````````````
+ * Signing Daemon
+ *
+ *     hashd [-j workers] [-w window] <socket>
+ *
+ * Serves the hashd.h protocol on a Unix stream socket, with one
+ * libhuffsig context for the whole life of the process: the heap and
+ * the workers are set up once and stay warm between requests.
+ *
+ * Each connection gets a thread that reads requests and hands them to
+ * the context with huffsig_submit, keeping up to window of them in
+ * flight. It only stops reading to send replies when the window is full
+ * or the client has nothing more queued, so a client that pipelines
+ * gets its requests hashed in parallel with each other, and the replies
+ * still go out in the order the requests came in.
+ *
+ * Payload read into slots counts against MAX_HELD bytes per connection,
+ * and a request that would go over it waits for the ones before it to
+ * be answered first, so a client can't pin more than that however deep
+ * it pipelines. At most MAX_CONNS connections are served at once;
+ * further clients wait in the listen backlog until one hangs up, so
+ * the threads and their payload stay bounded however many connect.
+ *
+ * A connection that sends HASHD_RING turns into a ring's server: the
+ * same thread and the same window of slots, but taking entries off the
+ * ring's submission ring and answering on its completion ring.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "hashd.h"
+#include "hring.h"
+#include "huffsig.h"
+
+#define DEFAULT_WINDOW 32
+#define RING_POLL_MS 100           // how often an idle ring checks whether its client went away
+#define STREAM_CHUNK (1UL << 20)   // a descriptor longer than this is hashed as it's read instead of held in its slot
+#define MAX_HELD HASHD_MAX_DATA    // bytes of payload a connection's slots hold at once
+#define MAX_CONNS 64               // connections served at once
+
+typedef struct {
+    huffsig_job job;
+    hashd_reply reply;
+    int submitted;   // reply.signature comes from the job
+    void *buf;       // to free once the job is done
+    size_t len;
+    size_t held;     // bytes of buf counted against the connection's MAX_HELD
+    uint64_t user_data;   // ring entries only
+} slot_t;
+
+typedef struct {
+    void *base;
+    size_t len;
+} region_t;
+
+typedef struct {
+    int fd;
+    int dead;        // a reply couldn't be sent, stop reading
+    slot_t *slots;
+    long head, tail; // slots in flight are [head, tail), modulo window
+    size_t held;     // sum of held over the slots in flight
+    region_t regions[HASHD_MAX_REGIONS];
+    int num_regions;
+} conn_t;
+
+static huffsig_ctx *ctx;
+static int window = DEFAULT_WINDOW;
+static const char *socket_path;
+static int live_conns;             // connection threads running, under conns_lock
+static pthread_mutex_t conns_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t conn_done = PTHREAD_COND_INITIALIZER;
+
+static int read_all(int fd, void *buf, size_t len) {
+    unsigned char *p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+static int send_all(int fd, const void *buf, size_t len) {
+    const unsigned char *p = buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+// Reads the next request header and the descriptor that came with it, if any (-1 if not). Returns 0 at EOF.
+static int read_request(int fd, hashd_request *req, int *passed_fd) {
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = { req, sizeof(*req) };
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    *passed_fd = -1;
+    ssize_t n;
+    do
+        n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    while (n < 0 && errno == EINTR);
+    if (n <= 0)
+        return 0;
+
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    if (c && c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS)
+        memcpy(passed_fd, CMSG_DATA(c), sizeof(int));
+
+    // The descriptor rides on the first byte, the rest of the header may come later
+    if ((size_t)n < sizeof(*req) && !read_all(fd, (char *)req + n, sizeof(*req) - n)) {
+        if (*passed_fd >= 0)
+            close(*passed_fd);
+        return 0;
+    }
+    return 1;
+}
+
+// The library's signature, or ENOMEM if its heap ran out
+static void set_signature(hashd_reply *reply, unsigned long signature) {
+    if (signature == HUFFSIG_ERROR)
+        reply->status = ENOMEM;
+    else
+        reply->signature = signature;
+}
+
+// Everything in fd. It's read rather than mapped even for regular files, since whoever else has the file open could
+// truncate it and take the pages out from under the workers. Up to STREAM_CHUNK bytes stay in the slot to be hashed
+// alongside the other requests in flight; anything longer is hashed on this thread as it's read. Returns 0 or an errno
+// value.
+static int load_fd(slot_t *s, int fd) {
+    huffsig_stream stream;
+    int streaming = 0;
+    size_t len = 0;
+    while (1) {
+        if (len == s->held) {
+            if (s->held == STREAM_CHUNK) {
+                if (!streaming)
+                    huffsig_stream_init(&stream);
+                streaming = 1;
+                huffsig_update(ctx, &stream, s->buf, len);
+                len = 0;
+            } else {
+                size_t cap = s->held ? s->held * 2 : 64 * 1024;
+                void *p = realloc(s->buf, cap);
+                if (!p)
+                    return ENOMEM;
+                s->buf = p;
+                s->held = cap;
+            }
+        }
+        ssize_t n = read(fd, (char *)s->buf + len, s->held - len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return errno;
+        if (n == 0)
+            break;
+        len += n;
+    }
+
+    if (streaming) {
+        huffsig_update(ctx, &stream, s->buf, len);
+        set_signature(&s->reply, huffsig_finish(ctx, &stream));
+        free(s->buf);
+        s->buf = NULL;
+        s->held = 0;
+        return 0;
+    }
+    s->len = len;
+    huffsig_submit(ctx, &s->job, s->buf, s->len);
+    s->submitted = 1;
+    return 0;
+}
+
+// Waits for the oldest request in flight and sends its reply
+static void retire(conn_t *c) {
+    slot_t *s = &c->slots[c->head++ % window];
+    if (s->submitted)
+        set_signature(&s->reply, huffsig_wait(ctx, &s->job));
+    free(s->buf);
+    c->held -= s->held;
+    if (!c->dead && !send_all(c->fd, &s->reply, sizeof(s->reply)))
+        c->dead = 1;
+}
+
+// Retires requests until the connection can hold need more bytes
+static void make_room(conn_t *c, size_t need) {
+    while (c->head < c->tail && c->held + need > MAX_HELD)
+        retire(c);
+}
+
+// The client keeps the memfd and could shrink it under the mapping, so it has to be sealed against that first
+static int map_region(conn_t *c, int fd, hashd_reply *reply) {
+    struct stat st;
+    if (c->num_regions == HASHD_MAX_REGIONS)
+        return ENOSPC;
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals < 0 || !(seals & F_SEAL_SHRINK))
+        return EPERM;
+    if (fstat(fd, &st) < 0)
+        return errno;
+    void *p = NULL;   // an empty region is fine, there's just nothing in it to hash
+    if (st.st_size > 0 && (p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
+        return errno;
+    c->regions[c->num_regions].base = p;
+    c->regions[c->num_regions].len = st.st_size;
+    reply->signature = c->num_regions++;
+    return 0;
+}
+
+static int has_input(int fd) {
+    struct pollfd p = { fd, POLLIN, 0 };
+    return poll(&p, 1, 0) > 0;
+}
+
+// Waits for the oldest ring entry in flight and posts its completion. Returns 0 if the client went away first.
+static int retire_entry(conn_t *c, hring_t *r) {
+    slot_t *s = &c->slots[c->head++ % window];
+    if (s->submitted)
+        set_signature(&s->reply, huffsig_wait(ctx, &s->job));
+    while (hring_complete(r, s->user_data, s->reply.status, s->reply.signature) < 0) {
+        if (atomic_load(&r->hdr->closed) || has_input(c->fd))
+            return 0;
+        sched_yield();
+    }
+    return 1;
+}
+
+// Serves the ring until the client closes it or hangs up
+static void serve_ring(conn_t *c, hring_t *r) {
+    while (1) {
+        long in_flight = c->tail - c->head;
+        uint64_t offset, len, user_data;
+        if (in_flight < window && hring_pop(r, &offset, &len, &user_data)) {
+            slot_t *s = &c->slots[c->tail++ % window];
+            memset(s, 0, sizeof(*s));
+            s->user_data = user_data;
+            if (offset > r->data_size || len > r->data_size - offset)
+                s->reply.status = EINVAL;
+            else {
+                huffsig_submit(ctx, &s->job, r->data + offset, len);
+                s->submitted = 1;
+            }
+            continue;
+        }
+        if (in_flight > 0) {
+            if (!retire_entry(c, r))
+                break;
+            continue;
+        }
+        if (atomic_load(&r->hdr->closed) || has_input(c->fd))
+            break;
+        hring_wait_sq(r, RING_POLL_MS);
+    }
+
+    // The jobs still point into the ring, so they finish before it's unmapped
+    while (c->head < c->tail) {
+        slot_t *s = &c->slots[c->head++ % window];
+        if (s->submitted)
+            huffsig_wait(ctx, &s->job);
+    }
+}
+
+// Answers HASHD_RING with whether the ring adds up, and serves it if it does
+static void run_ring(conn_t *c, int fd, hashd_reply *reply) {
+    while (c->head < c->tail)
+        retire(c);
+
+    struct stat st;
+    void *p = MAP_FAILED;
+    hring_t r;
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals < 0 || !(seals & F_SEAL_SHRINK))
+        reply->status = EPERM;
+    else if (fstat(fd, &st) < 0)
+        reply->status = errno;
+    else if ((p = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+        reply->status = errno;
+    else if (!hring_attach(&r, p, st.st_size))
+        reply->status = EINVAL;
+
+    if (send_all(c->fd, reply, sizeof(*reply)) && !reply->status)
+        serve_ring(c, &r);
+    if (p != MAP_FAILED)
+        munmap(p, st.st_size);
+}
+
+// Sets up the next slot for the request. Returns 0 if the request is malformed and the connection should close.
+static int handle(conn_t *c, const hashd_request *req, int passed_fd) {
+    slot_t *s = &c->slots[c->tail % window];
+    memset(s, 0, sizeof(*s));
+    s->reply.id = req->id;
+
+    int wants_fd = req->kind == HASHD_FD || req->kind == HASHD_MAP || req->kind == HASHD_RING;
+    if (wants_fd != (passed_fd >= 0)) {
+        if (passed_fd >= 0)
+            close(passed_fd);
+        return 0;
+    }
+
+    switch (req->kind) {
+    case HASHD_PATH: {
+        char path[HASHD_MAX_PATH + 1];
+        if (req->len > HASHD_MAX_PATH || !read_all(c->fd, path, req->len))
+            return 0;
+        path[req->len] = '\0';
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            s->reply.status = errno;
+            break;
+        }
+        make_room(c, STREAM_CHUNK);
+        s->reply.status = load_fd(s, fd);
+        close(fd);
+        break;
+    }
+    case HASHD_FD:
+        make_room(c, STREAM_CHUNK);
+        s->reply.status = load_fd(s, passed_fd);
+        close(passed_fd);
+        break;
+    case HASHD_DATA:
+        if (req->len > HASHD_MAX_DATA)
+            return 0;
+        make_room(c, req->len);
+        s->buf = malloc(req->len ? req->len : 1);
+        if (!s->buf || !read_all(c->fd, s->buf, req->len)) {
+            free(s->buf);
+            return 0;
+        }
+        s->len = s->held = req->len;
+        huffsig_submit(ctx, &s->job, s->buf, s->len);
+        s->submitted = 1;
+        break;
+    case HASHD_MAP:
+        s->reply.status = map_region(c, passed_fd, &s->reply);
+        close(passed_fd);
+        break;
+    case HASHD_REGION: {
+        region_t *r = req->region < (uint32_t)c->num_regions ? &c->regions[req->region] : NULL;
+        if (!r || req->offset > r->len || req->len > r->len - req->offset) {
+            s->reply.status = EINVAL;
+            break;
+        }
+        huffsig_submit(ctx, &s->job, (char *)r->base + req->offset, req->len);
+        s->submitted = 1;
+        break;
+    }
+    case HASHD_RING:
+        run_ring(c, passed_fd, &s->reply);
+        close(passed_fd);
+        return 0;
+    default:
+        return 0;
+    }
+    c->held += s->held;
+    c->tail++;
+    return 1;
+}
+
+static void conn_finished(void) {
+    pthread_mutex_lock(&conns_lock);
+    live_conns--;
+    pthread_cond_signal(&conn_done);
+    pthread_mutex_unlock(&conns_lock);
+}
+
+static void *serve(void *arg) {
+    conn_t *c = arg;
+
+    while (!c->dead) {
+        long in_flight = c->tail - c->head;
+        if (in_flight == window || (in_flight > 0 && !has_input(c->fd))) {
+            retire(c);
+            continue;
+        }
+        hashd_request req;
+        int passed_fd;
+        if (!read_request(c->fd, &req, &passed_fd) || !handle(c, &req, passed_fd))
+            break;
+    }
+    while (c->head < c->tail)
+        retire(c);
+
+    for (int i = 0; i < c->num_regions; i++)
+        if (c->regions[i].base)
+            munmap(c->regions[i].base, c->regions[i].len);
+    close(c->fd);
+    free(c->slots);
+    free(c);
+    conn_finished();
+    return NULL;
+}
+
+static void stop(int sig) {
+    (void)sig;
+    unlink(socket_path);
+    _exit(0);
+}
+
+int main(int argc, char *argv[]) {
+    int workers = -1;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:w:")) != -1) {
+        switch (opt) {
+        case 'j':
+            workers = atoi(optarg);
+            break;
+        case 'w':
+            window = atoi(optarg);
+            break;
+        default:
+            optind = argc;
+            break;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "Usage: %s [-j workers] [-w window] <socket>\n", argv[0]);
+        return 1;
+    }
+    socket_path = argv[optind];
+    if (window < 1)
+        window = 1;
+
+    ctx = huffsig_create(workers);
+    if (!ctx) {
+        fprintf(stderr, "%s: can't start workers\n", argv[0]);
+        return 1;
+    }
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "%s: socket path too long\n", socket_path);
+        return 1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    unlink(socket_path);
+    if (lfd < 0 || bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(lfd, 64) < 0) {
+        perror(socket_path);
+        return 1;
+    }
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    signal(SIGPIPE, SIG_IGN);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    while (1) {
+        // Nobody new is taken off the backlog until there's room for them
+        pthread_mutex_lock(&conns_lock);
+        while (live_conns == MAX_CONNS)
+            pthread_cond_wait(&conn_done, &conns_lock);
+        pthread_mutex_unlock(&conns_lock);
+
+        int fd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EINTR && errno != ECONNABORTED)
+                perror("accept");
+            continue;
+        }
+        conn_t *c = calloc(1, sizeof(conn_t));
+        slot_t *slots = c ? calloc(window, sizeof(slot_t)) : NULL;
+        pthread_t t;
+        if (!slots) {
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->slots = slots;
+        pthread_mutex_lock(&conns_lock);
+        live_conns++;
+        pthread_mutex_unlock(&conns_lock);
+        if (pthread_create(&t, &attr, serve, c)) {
+            free(slots);
+            free(c);
+            close(fd);
+            conn_finished();
+        }
+    }
+}
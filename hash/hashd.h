@@ -0,0 +1,70 @@
+#ifndef HASHD_H
+#define HASHD_H
+
+/* `````````````````````````````````````````````````````````````````````
+ * hashd Protocol
+ *
+ * hashd keeps a libhuffsig context warm behind a Unix stream socket, so
+ * signing a small input costs a round trip instead of a process start,
+ * a heap setup and a thread spawn. hashc is the client that comes with it.
+ *
+ * A request is a hashd_request, followed by len bytes of payload for
+ * HASHD_PATH and HASHD_DATA. HASHD_FD and HASHD_MAP carry one file
+ * descriptor in SCM_RIGHTS ancillary data, sent with the request's
+ * header. Each request gets one hashd_reply, in the order the requests
+ * were sent, so a client can send as many as it likes before reading
+ * (pipelining) and match them up by id or by order.
+ *
+ *   HASHD_PATH    payload is a path; hashd opens and hashes the file
+ *   HASHD_FD      hashes everything in the passed descriptor
+ *   HASHD_DATA    payload is the data itself
+ *   HASHD_MAP     maps the passed descriptor, a memfd sealed with
+ *                 F_SEAL_SHRINK (EPERM if it isn't), and replies with
+ *                 its region number in signature
+ *   HASHD_REGION  hashes len bytes at offset of region region
+ *   HASHD_RING    serves the hring.h ring laid out in the passed
+ *                 descriptor, a memfd sealed like HASHD_MAP's, until
+ *                 the client closes it
+ *
+ * MAP and REGION are the shared memory path: map once, then every
+ * request hashes straight out of the client's pages without any copy.
+ * Regions belong to the connection and go away with it. HASHD_RING
+ * goes further and takes requests off the socket altogether: once its
+ * reply is sent, the connection belongs to the ring, and hashd hangs up
+ * when the client closes the ring or sends anything else.
+ *
+ * A reply's status is 0 or an errno value. A malformed request closes
+ * the connection.
+ */
+
+#include <stdint.h>
+
+enum {
+    HASHD_PATH = 1,
+    HASHD_FD,
+    HASHD_DATA,
+    HASHD_MAP,
+    HASHD_REGION,
+    HASHD_RING
+};
+
+#define HASHD_MAX_PATH 4096
+#define HASHD_MAX_DATA (64UL << 20)   // biggest HASHD_DATA payload
+#define HASHD_MAX_REGIONS 16          // per connection
+
+typedef struct {
+    uint32_t kind;
+    uint32_t id;        // echoed in the reply
+    uint32_t region;    // HASHD_REGION only
+    uint32_t pad;
+    uint64_t offset;    // HASHD_REGION only
+    uint64_t len;       // payload bytes, or bytes of the region
+} hashd_request;
+
+typedef struct {
+    uint32_t id;
+    int32_t status;
+    uint64_t signature;
+} hashd_reply;
+
+#endif
@@ -0,0 +1,366 @@
+/* `````````````````````````````````````````````````````````````````````
+ * Block Signature Index
+ *
+ *     hashindex [-j workers] <file> [index]
+ *     hashindex -v offset:len [-s signature] [-j workers] <file> [index]
+ *
+ * The signature is the sum of the block hashes modulo LARGE_PRIME, so
+ * it's the root of a binary tree whose leaves are the block hashes and
+ * whose every node is the sum of its children. The first form builds
+ * that tree and stores it next to the file (<file>.hidx unless an index
+ * is named), and prints the root, which is the signature the hash
+ * binaries print for the file.
+ *
+ * The second form checks a byte range against the index without reading
+ * the rest of the file: it re-hashes only the blocks the range touches,
+ * compares each with its leaf, then rebuilds their ancestors from the
+ * fresh hashes and the stored siblings and compares what comes out on
+ * top with the stored root (and with -s, with a signature known from
+ * somewhere else). Checking a range of a multi-GB file costs its own
+ * blocks and at most two stored nodes for each of the tree's levels.
+ *
+ * Index layout, native byte order:
+ *
+ *   index_header | level 0 (the leaves) | level 1 | ... | root
+ *
+ * every node a uint32_t, level k holding ceil(leaves / 2^k) of them. An
+ * odd node out at the end of a level is carried up on its own.
+ *
+ * The leaves are hashed by a libhuffsig context. The levels above are
+ * cheap next to them but still a pass over the whole tree, so they're
+ * split between threads too: each thread builds whole subtrees of
+ * 2^split leaves and the levels above those are finished on one thread.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "huffsig.h"
+
+#define INDEX_MAGIC 0x58444948u   // "HIDX"
+#define MAX_LEVELS 64
+
+typedef struct {
+    uint32_t magic;
+    uint32_t block_size;
+    uint64_t file_size;
+    uint64_t num_leaves;
+    uint32_t levels;      // leaves and root included, 0 for an empty file
+    uint32_t root;
+} index_header;
+
+// Where each level starts in the node array and how many nodes it has
+typedef struct {
+    int levels;
+    uint64_t offset[MAX_LEVELS];
+    uint64_t size[MAX_LEVELS];
+    uint64_t total;
+} shape_t;
+
+typedef struct {
+    uint32_t *nodes;
+    const shape_t *shape;
+    uint64_t first_leaf, end_leaf;   // a whole number of subtrees, except maybe the last
+    int top;                         // the level the subtrees end at
+} subtree_arg;
+
+static void tree_shape(shape_t *s, uint64_t num_leaves) {
+    s->levels = 0;
+    s->total = 0;
+    for (uint64_t n = num_leaves; n > 0; n = n == 1 ? 0 : (n + 1) / 2) {
+        s->offset[s->levels] = s->total;
+        s->size[s->levels] = n;
+        s->total += n;
+        s->levels++;
+    }
+}
+
+// Fills in nodes [first, end) of level k + 1 from level k
+static void build_level(uint32_t *nodes, const shape_t *s, int k, uint64_t first, uint64_t end) {
+    const uint32_t *child = nodes + s->offset[k];
+    uint32_t *parent = nodes + s->offset[k + 1];
+    for (uint64_t i = first; i < end; i++) {
+        uint64_t sum = child[2 * i];
+        if (2 * i + 1 < s->size[k])
+            sum += child[2 * i + 1];
+        parent[i] = (uint32_t)(sum % HUFFSIG_PRIME);
+    }
+}
+
+static void *build_subtrees(void *arg) {
+    subtree_arg *a = arg;
+    for (int k = 0; k < a->top; k++) {
+        uint64_t first = a->first_leaf >> (k + 1);
+        uint64_t end = (a->end_leaf + (1ULL << (k + 1)) - 1) >> (k + 1);
+        if (end > a->shape->size[k + 1])
+            end = a->shape->size[k + 1];
+        build_level(a->nodes, a->shape, k, first, end);
+    }
+    return NULL;
+}
+
+// Builds every level above the leaves, the lower ones in parallel
+static void build_tree(uint32_t *nodes, const shape_t *s, int threads) {
+    // Subtrees as big as they can be with still one for every thread
+    int split = 0;
+    while (split + 1 < s->levels && (s->size[0] >> (split + 1)) >= (uint64_t)threads)
+        split++;
+
+    if (threads > 1 && split > 0) {
+        uint64_t subtrees = s->size[split];
+        pthread_t tids[threads];
+        subtree_arg args[threads];
+        for (int t = 0; t < threads; t++) {
+            args[t].nodes = nodes;
+            args[t].shape = s;
+            args[t].first_leaf = (subtrees * t / threads) << split;
+            args[t].end_leaf = (subtrees * (t + 1) / threads) << split;
+            if (args[t].end_leaf > s->size[0])
+                args[t].end_leaf = s->size[0];
+            args[t].top = split;
+            pthread_create(&tids[t], NULL, build_subtrees, &args[t]);
+        }
+        for (int t = 0; t < threads; t++)
+            pthread_join(tids[t], NULL);
+    } else
+        split = 0;
+
+    for (int k = split; k + 1 < s->levels; k++)
+        build_level(nodes, s, k, 0, s->size[k + 1]);
+}
+
+static void *map_file(const char *path, size_t *len) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        perror(path);
+        close(fd);
+        return NULL;
+    }
+    *len = st.st_size;
+    void *p = *len ? mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0) : (void *)"";
+    close(fd);
+    if (p == MAP_FAILED) {
+        perror(path);
+        return NULL;
+    }
+    return p;
+}
+
+static int build_index(huffsig_ctx *ctx, const char *path, const char *index_path, int threads) {
+    size_t len;
+    const unsigned char *data = map_file(path, &len);
+    if (!data)
+        return 1;
+
+    index_header h = { INDEX_MAGIC, HUFFSIG_BLOCK_SIZE, len, (len + HUFFSIG_BLOCK_SIZE - 1) / HUFFSIG_BLOCK_SIZE, 0,
+                       0 };
+    shape_t s;
+    tree_shape(&s, h.num_leaves);
+    h.levels = s.levels;
+
+    unsigned long *leaves = malloc(sizeof(unsigned long) * (h.num_leaves ? h.num_leaves : 1));
+    uint32_t *nodes = malloc(sizeof(uint32_t) * (s.total ? s.total : 1));
+    if (!leaves || !nodes) {
+        perror("malloc");
+        return 1;
+    }
+    unsigned long signature = huffsig_leaves(ctx, data, len, leaves);
+    if (signature == HUFFSIG_ERROR) {
+        fprintf(stderr, "%s: out of tree memory\n", path);
+        return 1;
+    }
+    for (uint64_t i = 0; i < h.num_leaves; i++)
+        nodes[i] = (uint32_t)leaves[i];
+    free(leaves);
+    if (len)
+        munmap((void *)data, len);
+
+    build_tree(nodes, &s, threads);
+    h.root = s.levels ? nodes[s.offset[s.levels - 1]] : 0;
+    if (h.root != signature) {
+        fprintf(stderr, "%s: tree root %u doesn't match signature %lu\n", path, h.root, signature);
+        return 1;
+    }
+
+    FILE *fp = fopen(index_path, "wb");
+    if (!fp || fwrite(&h, sizeof(h), 1, fp) != 1 || fwrite(nodes, sizeof(uint32_t), s.total, fp) != s.total ||
+        fclose(fp) != 0) {
+        perror(index_path);
+        return 1;
+    }
+    free(nodes);
+    printf("%u  %s\n", h.root, path);
+    return 0;
+}
+
+static int verify_range(huffsig_ctx *ctx, const char *path, const char *index_path, uint64_t offset, uint64_t len,
+                        long expected) {
+    size_t index_len;
+    const unsigned char *index = map_file(index_path, &index_len);
+    if (!index)
+        return 1;
+    index_header h;
+    shape_t s;
+    if (index_len < sizeof(h)) {
+        fprintf(stderr, "%s: not an index\n", index_path);
+        return 1;
+    }
+    memcpy(&h, index, sizeof(h));
+    tree_shape(&s, h.num_leaves);
+    if (h.magic != INDEX_MAGIC || h.block_size != HUFFSIG_BLOCK_SIZE || h.levels != (uint32_t)s.levels ||
+        h.num_leaves != (h.file_size + HUFFSIG_BLOCK_SIZE - 1) / HUFFSIG_BLOCK_SIZE ||
+        index_len != sizeof(h) + s.total * sizeof(uint32_t)) {
+        fprintf(stderr, "%s: not an index\n", index_path);
+        return 1;
+    }
+    const uint32_t *nodes = (const uint32_t *)(index + sizeof(h));
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        return 1;
+    }
+    if ((uint64_t)st.st_size != h.file_size) {
+        printf("%s: size %lld, index says %llu\n", path, (long long)st.st_size, (unsigned long long)h.file_size);
+        return 1;
+    }
+    if (offset >= h.file_size || len == 0) {
+        fprintf(stderr, "%s: range outside the file\n", path);
+        return 1;
+    }
+    if (len > h.file_size - offset)
+        len = h.file_size - offset;
+
+    // Re-hash just the blocks the range touches
+    uint64_t first = offset / HUFFSIG_BLOCK_SIZE, last = (offset + len - 1) / HUFFSIG_BLOCK_SIZE;
+    uint64_t count = last - first + 1;
+    uint64_t start = first * HUFFSIG_BLOCK_SIZE;
+    size_t bytes = (last + 1) * HUFFSIG_BLOCK_SIZE > h.file_size ? h.file_size - start : count * HUFFSIG_BLOCK_SIZE;
+    unsigned char *buf = malloc(bytes);
+    unsigned long *fresh = malloc(sizeof(unsigned long) * count);
+    if (!buf || !fresh) {
+        perror("malloc");
+        return 1;
+    }
+    for (size_t done = 0; done < bytes;) {
+        ssize_t n = pread(fd, buf + done, bytes - done, start + done);
+        if (n <= 0) {
+            perror(path);
+            return 1;
+        }
+        done += n;
+    }
+    close(fd);
+    unsigned long signature = huffsig_leaves(ctx, buf, bytes, fresh);
+    free(buf);
+    if (signature == HUFFSIG_ERROR) {
+        fprintf(stderr, "%s: out of tree memory\n", path);
+        return 1;
+    }
+
+    int status = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        if (fresh[i] != nodes[first + i]) {
+            printf("block %llu: %lu, index says %u\n", (unsigned long long)(first + i), fresh[i], nodes[first + i]);
+            status = 1;
+        }
+    }
+
+    // Rebuild the ancestors of those blocks from the fresh hashes and the stored siblings, up to the root
+    for (int k = 0; k + 1 < s.levels; k++) {
+        const uint32_t *level = nodes + s.offset[k];
+        uint64_t parent_first = first / 2, parent_last = last / 2;
+        for (uint64_t p = parent_first; p <= parent_last; p++) {
+            uint64_t sum = 0;
+            for (uint64_t c = 2 * p; c <= 2 * p + 1 && c < s.size[k]; c++)
+                sum += c >= first && c <= last ? fresh[c - first] : level[c];
+            fresh[p - parent_first] = sum % HUFFSIG_PRIME;
+        }
+        first = parent_first;
+        last = parent_last;
+    }
+    if (fresh[0] != h.root) {
+        printf("root: %lu, index says %u\n", fresh[0], h.root);
+        status = 1;
+    }
+    if (expected >= 0 && (unsigned long)expected != h.root) {
+        printf("root: index says %u, expected %ld\n", h.root, expected);
+        status = 1;
+    }
+    free(fresh);
+    munmap((void *)index, index_len);
+
+    if (!status)
+        printf("%s: bytes %llu-%llu match (blocks %llu-%llu)\n", path, (unsigned long long)offset,
+               (unsigned long long)(offset + len - 1), (unsigned long long)(offset / HUFFSIG_BLOCK_SIZE),
+               (unsigned long long)((offset + len - 1) / HUFFSIG_BLOCK_SIZE));
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int verify = 0;
+    unsigned long long offset = 0, len = 0;
+    long expected = -1;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:v:s:")) != -1) {
+        switch (opt) {
+        case 'j':
+            threads = atoi(optarg);
+            break;
+        case 'v':
+            verify = sscanf(optarg, "%llu:%llu", &offset, &len) == 2;
+            if (!verify)
+                optind = argc;
+            break;
+        case 's':
+            expected = atol(optarg);
+            break;
+        default:
+            optind = argc;
+            break;
+        }
+    }
+    if (optind == argc || argc - optind > 2) {
+        fprintf(stderr, "Usage: %s [-j workers] <file> [index]\n", argv[0]);
+        fprintf(stderr, "       %s -v offset:len [-s signature] [-j workers] <file> [index]\n", argv[0]);
+        return 1;
+    }
+    if (threads < 1)
+        threads = 1;
+
+    const char *path = argv[optind];
+    char *index_path = NULL;
+    if (optind + 1 < argc)
+        index_path = strdup(argv[optind + 1]);
+    else if (asprintf(&index_path, "%s.hidx", path) < 0)
+        index_path = NULL;
+
+    // The calling thread hashes too
+    huffsig_ctx *ctx = huffsig_create(threads - 1);
+    if (!ctx || !index_path) {
+        fprintf(stderr, "%s: can't start\n", argv[0]);
+        return 1;
+    }
+
+    int status = verify ? verify_range(ctx, path, index_path, offset, len, expected)
+                        : build_index(ctx, path, index_path, threads);
+    huffsig_destroy(ctx);
+    free(index_path);
+    return status;
+}
@@ -0,0 +1,262 @@
+#ifndef HRING_H
+#define HRING_H
+
+/* `````````````````````````````````````````````````````````````````````
+ * Shared-Memory Signing Rings
+ *
+ * A region a client shares with hashd (a memfd, handed over once with
+ * HASHD_RING) holding a submission ring, a completion ring and a data
+ * area. Producers write their data straight into the data area and
+ * submit (offset, len) entries, hashd hashes the bytes where they lie
+ * and posts (user_data, signature) completions. After setup nothing
+ * goes through the socket, and no byte of data is copied.
+ *
+ *   | hring_header | sqes[entries] | cqes[entries] | data ... |
+ *
+ * Every entry carries a sequence number, so a ring is a bounded queue
+ * where an entry is readable exactly when its number says so (Vyukov's
+ * queue). The submission ring takes any number of producers: each
+ * claims an entry by advancing sq_tail with a CAS, fills it in and
+ * publishes it by bumping its sequence number, and hashd is its only
+ * consumer. hring_submit_sp skips the CAS when there's only ever one
+ * producer. hashd is the only producer of completions and one client
+ * thread at a time may reap them. Completions come out in the order
+ * hashd took the entries.
+ *
+ * A consumer with nothing to do sets its ring's sleeping word and
+ * sleeps on it with a futex; the producer that publishes next clears it
+ * and wakes the sleeper. The futexes are shared ones, since the two
+ * sides are different processes. A full ring isn't slept on: producers
+ * get -1 back and retry, and hashd yields until the client reaps.
+ *
+ * Nothing in the region can be trusted by hashd, so hring_attach copies
+ * out the geometry once, and hashd checks every entry's range against
+ * its own copy before hashing it. Nor can the region's size: hashd only
+ * maps a memfd sealed with F_SEAL_SHRINK, so the client can't cut the
+ * mapping short under it.
+ */
+
+#include <assert.h>
+#include <linux/futex.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HRING_MAGIC 0x48524e47u   // "HRNG"
+#define HRING_MIN_ENTRIES 2   // with one, a filled entry's number would also say it's free for the next lap
+#define HRING_MAX_ENTRIES 65536
+#define HRING_DATA_ALIGN 4096
+
+typedef struct {
+    _Atomic uint32_t seq;
+    uint32_t pad;
+    uint64_t offset;      // into the data area
+    uint64_t len;
+    uint64_t user_data;   // handed back in the completion
+} hring_sqe;
+
+typedef struct {
+    _Atomic uint32_t seq;
+    int32_t status;       // 0 or an errno value
+    uint64_t user_data;
+    uint64_t signature;
+    uint64_t pad;
+} hring_cqe;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t entries;                        // in each ring, a power of two
+    uint64_t data_offset;                    // from the start of the region
+    uint64_t data_size;
+    _Atomic uint32_t closed;                 // the client is done, hashd stops serving the ring
+    _Alignas(64) _Atomic uint32_t sq_tail;   // producers claim entries here
+    _Alignas(64) _Atomic int sq_sleeping;    // hashd is asleep waiting for submissions
+    _Alignas(64) _Atomic int cq_sleeping;    // the reaper is asleep waiting for completions
+} hring_header;
+
+// One side's view of a ring: pointers and geometry of its own, so the other side can't move them
+typedef struct {
+    hring_header *hdr;
+    hring_sqe *sq;
+    hring_cqe *cq;
+    unsigned char *data;
+    uint32_t mask;
+    uint64_t data_size;
+    uint32_t head;   // next entry this side consumes: submissions for hashd, completions for the client
+    uint32_t tail;   // next completion hashd posts
+} hring_t;
+
+static inline uint64_t hring_data_offset(uint32_t entries) {
+    uint64_t end = sizeof(hring_header) + entries * (sizeof(hring_sqe) + sizeof(hring_cqe));
+    return (end + HRING_DATA_ALIGN - 1) & ~(uint64_t)(HRING_DATA_ALIGN - 1);
+}
+
+// Bytes of region a ring of entries entries with data_size bytes of data needs
+static inline uint64_t hring_size(uint32_t entries, uint64_t data_size) {
+    return hring_data_offset(entries) + data_size;
+}
+
+static inline void hring_view(hring_t *r, void *region, uint32_t entries, uint64_t data_size) {
+    r->hdr = region;
+    r->sq = (hring_sqe *)(r->hdr + 1);
+    r->cq = (hring_cqe *)(r->sq + entries);
+    r->data = (unsigned char *)region + hring_data_offset(entries);
+    r->mask = entries - 1;
+    r->data_size = data_size;
+    r->head = 0;
+    r->tail = 0;
+}
+
+// Lays out a fresh ring in zeroed memory of hring_size bytes. entries must be a power of two, at least
+// HRING_MIN_ENTRIES.
+static inline void hring_init(hring_t *r, void *region, uint32_t entries, uint64_t data_size) {
+    assert(entries >= HRING_MIN_ENTRIES && !(entries & (entries - 1)));
+    hring_view(r, region, entries, data_size);
+    r->hdr->magic = HRING_MAGIC;
+    r->hdr->entries = entries;
+    r->hdr->data_offset = hring_data_offset(entries);
+    r->hdr->data_size = data_size;
+    for (uint32_t i = 0; i < entries; i++) {
+        atomic_init(&r->sq[i].seq, i);
+        atomic_init(&r->cq[i].seq, i);
+    }
+}
+
+// Checks the ring a client laid out in region_len bytes and takes its geometry. Returns 0 if it doesn't add up.
+static inline int hring_attach(hring_t *r, void *region, uint64_t region_len) {
+    hring_header *h = region;
+    if (region_len < sizeof(hring_header))
+        return 0;
+    uint32_t entries = h->entries;
+    uint64_t data_size = h->data_size;
+    if (h->magic != HRING_MAGIC || entries < HRING_MIN_ENTRIES || entries > HRING_MAX_ENTRIES || (entries & (entries - 1)) ||
+        h->data_offset != hring_data_offset(entries) || data_size > region_len ||
+        hring_size(entries, data_size) > region_len)
+        return 0;
+    hring_view(r, region, entries, data_size);
+    return 1;
+}
+
+static inline void hring_futex_wait(_Atomic int *word, int value, int timeout_ms) {
+    struct timespec ts = { timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000 };
+    syscall(SYS_futex, word, FUTEX_WAIT, value, timeout_ms >= 0 ? &ts : NULL, NULL, 0);
+}
+
+static inline void hring_wake(_Atomic int *sleeping) {
+    if (atomic_load(sleeping)) {
+        atomic_store(sleeping, 0);
+        syscall(SYS_futex, sleeping, FUTEX_WAKE, 1, NULL, NULL, 0);
+    }
+}
+
+/* =======================================================================
+   Submission Ring
+   ======================================================================= */
+
+static inline void hring_publish_sqe(hring_t *r, hring_sqe *e, uint32_t pos, uint64_t offset, uint64_t len,
+                                     uint64_t user_data) {
+    e->offset = offset;
+    e->len = len;
+    e->user_data = user_data;
+    atomic_store(&e->seq, pos + 1);
+    hring_wake(&r->hdr->sq_sleeping);
+}
+
+// Submits len bytes at offset in the data area, from any number of producers. Returns -1 if the ring is full.
+static inline int hring_submit(hring_t *r, uint64_t offset, uint64_t len, uint64_t user_data) {
+    uint32_t pos = atomic_load_explicit(&r->hdr->sq_tail, memory_order_relaxed);
+    while (1) {
+        hring_sqe *e = &r->sq[pos & r->mask];
+        int32_t diff = (int32_t)(atomic_load_explicit(&e->seq, memory_order_acquire) - pos);
+        if (diff < 0)
+            return -1;
+        if (diff > 0)
+            pos = atomic_load_explicit(&r->hdr->sq_tail, memory_order_relaxed);
+        else if (atomic_compare_exchange_weak_explicit(&r->hdr->sq_tail, &pos, pos + 1, memory_order_relaxed,
+                                                       memory_order_relaxed)) {
+            hring_publish_sqe(r, e, pos, offset, len, user_data);
+            return 0;
+        }
+    }
+}
+
+// hring_submit for a ring that only ever has the one producer
+static inline int hring_submit_sp(hring_t *r, uint64_t offset, uint64_t len, uint64_t user_data) {
+    uint32_t pos = atomic_load_explicit(&r->hdr->sq_tail, memory_order_relaxed);
+    hring_sqe *e = &r->sq[pos & r->mask];
+    if (atomic_load_explicit(&e->seq, memory_order_acquire) != pos)
+        return -1;
+    atomic_store_explicit(&r->hdr->sq_tail, pos + 1, memory_order_relaxed);
+    hring_publish_sqe(r, e, pos, offset, len, user_data);
+    return 0;
+}
+
+// hashd: takes the next submission, if there is one
+static inline int hring_pop(hring_t *r, uint64_t *offset, uint64_t *len, uint64_t *user_data) {
+    hring_sqe *e = &r->sq[r->head & r->mask];
+    if (atomic_load_explicit(&e->seq, memory_order_acquire) != r->head + 1)
+        return 0;
+    *offset = e->offset;
+    *len = e->len;
+    *user_data = e->user_data;
+    atomic_store_explicit(&e->seq, r->head + r->mask + 1, memory_order_release);
+    r->head++;
+    return 1;
+}
+
+// hashd: sleeps until a submission arrives, or for timeout_ms at most
+static inline void hring_wait_sq(hring_t *r, int timeout_ms) {
+    atomic_store(&r->hdr->sq_sleeping, 1);
+    if (atomic_load(&r->sq[r->head & r->mask].seq) != r->head + 1 && !atomic_load(&r->hdr->closed))
+        hring_futex_wait(&r->hdr->sq_sleeping, 1, timeout_ms);
+    atomic_store(&r->hdr->sq_sleeping, 0);
+}
+
+/* =======================================================================
+   Completion Ring
+   ======================================================================= */
+
+// hashd: posts a completion. Returns -1 if the ring is full.
+static inline int hring_complete(hring_t *r, uint64_t user_data, int32_t status, uint64_t signature) {
+    hring_cqe *e = &r->cq[r->tail & r->mask];
+    if (atomic_load_explicit(&e->seq, memory_order_acquire) != r->tail)
+        return -1;
+    e->user_data = user_data;
+    e->status = status;
+    e->signature = signature;
+    atomic_store(&e->seq, r->tail + 1);
+    r->tail++;
+    hring_wake(&r->hdr->cq_sleeping);
+    return 0;
+}
+
+// Takes the next completion, if there is one
+static inline int hring_reap(hring_t *r, uint64_t *user_data, int32_t *status, uint64_t *signature) {
+    hring_cqe *e = &r->cq[r->head & r->mask];
+    if (atomic_load_explicit(&e->seq, memory_order_acquire) != r->head + 1)
+        return 0;
+    *user_data = e->user_data;
+    *status = e->status;
+    *signature = e->signature;
+    atomic_store_explicit(&e->seq, r->head + r->mask + 1, memory_order_release);
+    r->head++;
+    return 1;
+}
+
+// Sleeps until a completion arrives, or for timeout_ms at most
+static inline void hring_wait_cq(hring_t *r, int timeout_ms) {
+    atomic_store(&r->hdr->cq_sleeping, 1);
+    if (atomic_load(&r->cq[r->head & r->mask].seq) != r->head + 1)
+        hring_futex_wait(&r->hdr->cq_sleeping, 1, timeout_ms);
+    atomic_store(&r->hdr->cq_sleeping, 0);
+}
+
+// Client: tells hashd the ring is done with
+static inline void hring_close(hring_t *r) {
+    atomic_store(&r->hdr->closed, 1);
+    hring_wake(&r->hdr->sq_sleeping);
+}
+
+#endif
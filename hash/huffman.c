@@ -0,0 +1,282 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "huffman.h"
+#include "umem.h"
+
+/* =======================================================================
+   Huffman Tree Construction (Given)
+   ======================================================================= */
+
+MinHeap *heap_create(int capacity) {
+    MinHeap *h = umalloc(sizeof(MinHeap));
+    if (!h) return NULL;
+    h->data = umalloc(sizeof(Node *) * capacity);
+    if (!h->data) {
+        ufree(h);
+        return NULL;
+    }
+    h->size = 0;
+    h->capacity = capacity;
+    return h;
+}
+
+void heap_swap(Node **a, Node **b) {
+    Node *tmp = *a; *a = *b; *b = tmp;
+}
+
+void heap_push(MinHeap *h, Node *node) {
+    int i = h->size++;
+    h->data[i] = node;
+    while (i > 0) {
+        int p = (i - 1) / 2;
+        if (h->data[p]->freq < h->data[i]->freq) break;
+        heap_swap(&h->data[p], &h->data[i]);
+        i = p;
+    }
+}
+
+Node *heap_pop(MinHeap *h) {
+    if (h->size == 0) return NULL;
+    Node *min = h->data[0];
+    h->data[0] = h->data[--h->size];
+    int i = 0;
+    while (1) {
+        int l = 2 * i + 1, r = l + 1, smallest = i;
+        if (l < h->size && h->data[l]->freq < h->data[smallest]->freq) smallest = l;
+        if (r < h->size && h->data[r]->freq < h->data[smallest]->freq) smallest = r;
+        if (smallest == i) break;
+        heap_swap(&h->data[i], &h->data[smallest]);
+        i = smallest;
+    }
+    return min;
+}
+
+void heap_free(MinHeap *h) {
+    ufree(h->data);
+    ufree(h);
+}
+
+Node *new_node(unsigned char sym, unsigned long freq, Node *l, Node *r) {
+    Node *n = umalloc(sizeof(Node));
+    if (!n) return NULL;
+    n->symbol = sym;
+    n->freq = freq;
+    n->left = l;
+    n->right = r;
+    return n;
+}
+
+void free_tree(Node *n) {
+    if (!n) return;
+    free_tree(n->left);
+    free_tree(n->right);
+    ufree(n);
+}
+
+// Frees the heap and every tree still on it, after an allocation failed
+static void abandon_heap(MinHeap *h) {
+    for (int i = 0; i < h->size; i++)
+        free_tree(h->data[i]);
+    heap_free(h);
+}
+
+// NULL if no symbol turns up, or if umalloc failed (*failed is set then)
+Node *build_tree(const unsigned long freq[SYMBOLS], int *failed) {
+    *failed = 0;
+    MinHeap *h = heap_create(SYMBOLS);
+    if (!h) {
+        *failed = 1;
+        return NULL;
+    }
+    for (int i = 0; i < SYMBOLS; i++) {
+        if (freq[i] > 0) {
+            Node *leaf = new_node((unsigned char)i, freq[i], NULL, NULL);
+            if (!leaf) {
+                abandon_heap(h);
+                *failed = 1;
+                return NULL;
+            }
+            heap_push(h, leaf);
+        }
+    }
+    if (h->size == 0) {
+        heap_free(h);
+        return NULL;
+    }
+    while (h->size > 1) {
+        Node *a = heap_pop(h);
+        Node *b = heap_pop(h);
+        Node *p = new_node(0, a->freq + b->freq, a, b);
+        if (!p) {
+            free_tree(a);
+            free_tree(b);
+            abandon_heap(h);
+            *failed = 1;
+            return NULL;
+        }
+        heap_push(h, p);
+    }
+    Node *root = heap_pop(h);
+    heap_free(h);
+    return root;
+}
+
+unsigned long hash_tree(Node *n, unsigned long hash) {
+    if (!n) return hash;
+    hash = (hash * 31 + n->freq + n->symbol) % LARGE_PRIME;
+    hash = hash_tree(n->left, hash);
+    hash = hash_tree(n->right, hash);
+    return hash;
+}
+
+/* =======================================================================
+   Small Alphabets
+   -----------------------------------------------------------------------
+   Text like pi.txt's digits or a log has a handful of distinct symbols,
+   and for those the umalloc'd heap and nodes cost more than the tree.
+   hash_small builds the same tree in an array on the stack: the same
+   heap, pushed in the same order and sifted with the same comparisons,
+   so equal frequencies tie the same way and the hash comes out bit for
+   bit the same. Sorting the leaves instead would pair ties differently.
+   ======================================================================= */
+
+typedef struct {
+    unsigned long freq;
+    unsigned char symbol;
+    signed char left, right;   // -1 for none
+} small_node;
+
+typedef struct {
+    small_node nodes[2 * SMALL_SYMBOLS - 1];
+    signed char heap[SMALL_SYMBOLS];
+    int size;
+} small_tree;
+
+static void small_push(small_tree *t, int node) {
+    int i = t->size++;
+    t->heap[i] = node;
+    while (i > 0) {
+        int p = (i - 1) / 2;
+        if (t->nodes[t->heap[p]].freq < t->nodes[t->heap[i]].freq) break;
+        signed char tmp = t->heap[p]; t->heap[p] = t->heap[i]; t->heap[i] = tmp;
+        i = p;
+    }
+}
+
+static int small_pop(small_tree *t) {
+    int min = t->heap[0];
+    t->heap[0] = t->heap[--t->size];
+    int i = 0;
+    while (1) {
+        int l = 2 * i + 1, r = l + 1, smallest = i;
+        if (l < t->size && t->nodes[t->heap[l]].freq < t->nodes[t->heap[smallest]].freq) smallest = l;
+        if (r < t->size && t->nodes[t->heap[r]].freq < t->nodes[t->heap[smallest]].freq) smallest = r;
+        if (smallest == i) break;
+        signed char tmp = t->heap[i]; t->heap[i] = t->heap[smallest]; t->heap[smallest] = tmp;
+        i = smallest;
+    }
+    return min;
+}
+
+static unsigned long small_hash(const small_tree *t, int n, unsigned long hash) {
+    if (n < 0) return hash;
+    hash = (hash * 31 + t->nodes[n].freq + t->nodes[n].symbol) % LARGE_PRIME;
+    hash = small_hash(t, t->nodes[n].left, hash);
+    hash = small_hash(t, t->nodes[n].right, hash);
+    return hash;
+}
+
+// build_tree and hash_tree for the symbols set in present, at most SMALL_SYMBOLS of them and at least one
+static unsigned long hash_small(const unsigned long freq[SYMBOLS], const uint64_t present[SYMBOLS / 64]) {
+    small_tree t;
+    int count = 0;
+    t.size = 0;
+    for (int w = 0; w < SYMBOLS / 64; w++) {
+        for (uint64_t bits = present[w]; bits; bits &= bits - 1) {
+            int sym = w * 64 + __builtin_ctzll(bits);
+            t.nodes[count] = (small_node){ freq[sym], (unsigned char)sym, -1, -1 };
+            small_push(&t, count++);
+        }
+    }
+    while (t.size > 1) {
+        int a = small_pop(&t);
+        int b = small_pop(&t);
+        t.nodes[count] = (small_node){ t.nodes[a].freq + t.nodes[b].freq, 0, (signed char)a, (signed char)b };
+        small_push(&t, count++);
+    }
+    return small_hash(&t, small_pop(&t), 0);
+}
+
+/* =======================================================================
+   Output Functions
+   ======================================================================= */
+
+void print_intermediate(int block_num, unsigned long hash, pid_t pid) {
+#ifdef DEBUG
+#  if DEBUG == 2
+    printf("[PID %d] Block %d hash: %lu\n", pid, block_num, hash);
+#  elif DEBUG == 1
+    printf("Block %d hash: %lu\n", block_num, hash);
+#  endif
+#else
+    (void)block_num;
+    (void)hash;
+    (void)pid;
+#endif
+}
+
+int print_final(unsigned long final_hash) {
+    if (final_hash == HASH_FAILED) {
+        fprintf(stderr, "umalloc failed building a tree\n");
+        return 1;
+    }
+    printf("Final signature: %lu\n", final_hash);
+    return 0;
+}
+
+/* =======================================================================
+   Block Signature
+   ======================================================================= */
+
+unsigned long add_hash(unsigned long sum, unsigned long h) {
+    if (sum == HASH_FAILED || h == HASH_FAILED)
+        return HASH_FAILED;
+    return (sum + h) % LARGE_PRIME;
+}
+
+void count_symbols(const unsigned char *buf, size_t len, unsigned long freq[SYMBOLS]) {
+    for (size_t i = 0; i < len; i++)
+        freq[buf[i]]++;
+}
+
+unsigned long hash_counts(const unsigned long freq[SYMBOLS]) {
+    // Which symbols turn up, a bit each, without a branch per symbol. Built from the finished counts rather than while
+    // counting: one pass over 256 slots costs less than an extra OR per byte of a 1 KB block, and count_symbols stays
+    // a plain add that huffsig's slices can merge.
+    uint64_t present[SYMBOLS / 64] = { 0 };
+    for (int i = 0; i < SYMBOLS; i++)
+        present[i / 64] |= (uint64_t)(freq[i] != 0) << (i % 64);
+    int distinct = 0;
+    for (int w = 0; w < SYMBOLS / 64; w++)
+        distinct += __builtin_popcountll(present[w]);
+    if (distinct == 0)
+        return 0;
+    if (distinct <= SMALL_SYMBOLS)
+        return hash_small(freq, present);
+
+    int failed;
+    Node *root = build_tree(freq, &failed);
+    if (failed)
+        return HASH_FAILED;
+    unsigned long h = hash_tree(root, 0);
+    free_tree(root);
+    return h;
+}
+
+unsigned long process_block(const unsigned char *buf, size_t len) {
+    unsigned long freq[SYMBOLS] = {0};
+    count_symbols(buf, len, freq);
+    return hash_counts(freq);
+}
@@ -0,0 +1,87 @@
+#ifndef HUFFMAN_H
+#define HUFFMAN_H
+
+/* `````````````````````````````````````````````````````````````````````
+ * Huffman Hashing Engine
+ *
+ * Every hash binary is this engine (main.c and huffman.c) linked with
+ * one allocator backend (a umem_*.c, see umem.h) and one parallel
+ * executor (an exec_*.c), all picked in CMakeLists.txt:
+ *
+ *   <file>        run_single, in main.c, hashes block after block
+ *   <file> -t     run_threads, from whichever executor was linked in:
+ *                   exec_threads.c    a thread per block
+ *                   exec_processes.c  a child process per block
+ *                   exec_pool.c       one worker per core, work stealing
+ *   <file> --auto run_auto, in autotune.c, whichever of the two it
+ *                 expects to finish first
+ *
+ * -m is accepted as an alias for -t. Nothing is chosen at run time, so
+ * every umalloc and ufree on the hot path is a direct call.
+ */
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define BLOCK_SIZE 1024
+#define SYMBOLS 256
+#define LARGE_PRIME 2147483647   // for modular hash
+#define SMALL_SYMBOLS 16         // blocks with this many distinct symbols or fewer skip the umalloc'd tree
+#define HASH_FAILED ((unsigned long)-1)   // umalloc ran out building the tree, never a hash since those are below LARGE_PRIME
+
+// Everything the engine asks umalloc for is declared here, so a backend can size its classes from them
+
+typedef struct Node {
+    unsigned char symbol;
+    unsigned long freq;
+    struct Node *left, *right;
+} Node;
+
+typedef struct {
+    Node **data;
+    int size;
+    int capacity;
+} MinHeap;
+
+// One block's result on a cache line of its own, so threads finishing neighbouring blocks don't fight over the line
+typedef struct {
+    _Alignas(64) unsigned long hash;
+} result_t;
+
+// Thread argument structure
+typedef struct {
+    int block_id;
+    unsigned char *block_buf;
+    size_t block_len;
+    result_t *results;
+} thread_arg_t;
+
+// What run_auto needs to know about the executor linked in; each exec_*.c defines exec_info
+typedef struct {
+    const char *name;
+    int per_block;    // starts something per block rather than per worker
+    int forks;        // and that something is a process
+    long max_blocks;  // the most blocks it takes, 0 for no limit
+} exec_info_t;
+
+extern const exec_info_t exec_info;
+extern long exec_workers;   // workers for a per-worker executor to start, 0 for one per core
+
+// HASH_FAILED if umalloc runs out
+unsigned long process_block(const unsigned char *buf, size_t len);
+
+// process_block in two halves, so a big block can be counted in pieces: count_symbols adds buf's symbols to freq,
+// hash_counts builds the tree for freq and hashes it
+void count_symbols(const unsigned char *buf, size_t len, unsigned long freq[SYMBOLS]);
+unsigned long hash_counts(const unsigned long freq[SYMBOLS]);
+// sum + h modulo LARGE_PRIME, HASH_FAILED if either is
+unsigned long add_hash(unsigned long sum, unsigned long h);
+void print_intermediate(int block_num, unsigned long hash, pid_t pid);
+// Prints the signature and returns 0, or says the hash failed and returns 1
+int print_final(unsigned long final_hash);
+
+int run_single(const char *filename);
+int run_threads(const char *filename);
+int run_auto(const char *filename);
+
+#endif
@@ -0,0 +1,371 @@
+/* `````````````````````````````````````````````````````````````````````
+ * libhuffsig
+ *
+ * huffsig.h's API over the engine's process_block and the slab backend.
+ *
+ * A run of blocks to hash is a job, which lives in the caller's memory
+ * (on its stack, for huffsig_buffer). The job goes on the context's
+ * list, where idle workers find it, and the thread that waits for it
+ * hashes it too. Everybody claims blocks with a fetch-and-add on the
+ * job's next block, so nobody waits for anybody until the last block is
+ * claimed. The waiting thread then takes the job off the list (so no
+ * new helpers can find it) and waits for the helpers still hashing to
+ * leave before the job's memory can go away.
+ *
+ * A big block is a job of its own whose blocks are HUFFSIG_SPLIT_SIZE
+ * slices of it. Everybody counts the slices they claim into a table of
+ * their own and adds it to the job's on the way out, and the waiting
+ * thread builds the tree once every count is in. Counts add up the same
+ * in any order, so the tree, and the hash, is the one process_block
+ * would have built.
+ *
+ * However many workers and callers there are, only HUFFSIG_MAX_TREES
+ * trees are built at once across the process, so they all fit in the
+ * heap: a thread with its symbols counted waits on tree_slots for one
+ * of them. Blocks that fail anyway make the sum HASH_FAILED, which
+ * add_hash keeps through every later sum and huffsig.h calls
+ * HUFFSIG_ERROR.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cdc.h"
+#include "huffman.h"
+#include "huffsig.h"
+#include "umem.h"
+
+_Static_assert(HUFFSIG_BLOCK_SIZE == BLOCK_SIZE, "huffsig.h and huffman.h disagree on the block size");
+_Static_assert(HUFFSIG_PRIME == LARGE_PRIME, "huffsig.h and huffman.h disagree on the modulus");
+_Static_assert(HUFFSIG_ERROR == HASH_FAILED, "huffsig.h and huffman.h disagree on the failed hash");
+
+// A tree for all 256 symbols takes about 4.5 of the slab backend's 384 pages, so this many leave room to spare
+#define HUFFSIG_MAX_TREES 64
+
+typedef huffsig_job job_t;
+
+struct huffsig_ctx {
+    pthread_mutex_t lock;
+    pthread_cond_t work;        // workers wait here for jobs
+    pthread_cond_t finished;    // jobs' owners wait here for their helpers
+    job_t *jobs;                // jobs that may still have unclaimed blocks, oldest first
+    int stop;
+    int num_workers;
+    pthread_t workers[];
+};
+
+static pthread_once_t umem_once = PTHREAD_ONCE_INIT;
+static _Atomic int next_tid;   // umem thread ids, across every context
+static sem_t tree_slots;       // trees that may still be built at once, across every context
+
+// One heap for the whole process, every thread may be allocating from it at once
+static void umem_setup(void) {
+    use_multiprocess = 1;
+    init_umem();
+    sem_init(&tree_slots, 0, HUFFSIG_MAX_TREES);
+}
+
+// hash_counts once one of the HUFFSIG_MAX_TREES slots is free
+static unsigned long hash_tree_slot(const unsigned long freq[SYMBOLS]) {
+    while (sem_wait(&tree_slots) && errno == EINTR)
+        ;
+    unsigned long h = hash_counts(freq);
+    sem_post(&tree_slots);
+    return h;
+}
+
+// process_block, taking a tree slot
+static unsigned long hash_block(const unsigned char *buf, size_t len) {
+    unsigned long freq[SYMBOLS] = { 0 };
+    count_symbols(buf, len, freq);
+    return hash_tree_slot(freq);
+}
+
+typedef unsigned long counts_vec __attribute__((vector_size(32)));
+
+// Adds one symbol count table to another, a vector of counts at a time
+static void merge_counts(unsigned long into[SYMBOLS], const unsigned long from[SYMBOLS]) {
+    for (int i = 0; i < SYMBOLS; i += sizeof(counts_vec) / sizeof(unsigned long)) {
+        counts_vec a, b;
+        memcpy(&a, into + i, sizeof(a));
+        memcpy(&b, from + i, sizeof(b));
+        a += b;
+        memcpy(into + i, &a, sizeof(a));
+    }
+}
+
+// Hashes blocks of the job until none are left to claim, and returns the sum of their hashes. If the job is counting
+// one big block, adds the symbols of the slices claimed to counts instead.
+static unsigned long work_on(job_t *job, unsigned long counts[SYMBOLS]) {
+    size_t block_size = job->counts ? HUFFSIG_SPLIT_SIZE : BLOCK_SIZE;
+    unsigned long sum = 0;
+    size_t b;
+    while ((b = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed)) < job->num_blocks) {
+        size_t offset, len;
+        if (job->ends) {
+            offset = b ? job->ends[b - 1] : 0;
+            len = job->ends[b] - offset;
+        } else {
+            offset = b * block_size;
+            len = job->len - offset < block_size ? job->len - offset : block_size;
+        }
+        if (job->counts) {
+            count_symbols(job->data + offset, len, counts);
+            continue;
+        }
+        if (len >= HUFFSIG_SPLIT_SIZE)
+            continue;   // a big chunk, huffsig_chunks splits it up once the rest are done
+        unsigned long h = hash_block(job->data + offset, len);
+        if (job->leaves)
+            job->leaves[b] = h;
+        sum = add_hash(sum, h);
+    }
+    return sum;
+}
+
+// Takes a job off the list if it's still on it. Caller holds the lock.
+static void unlink_job(huffsig_ctx *ctx, job_t *job) {
+    for (job_t **p = &ctx->jobs; *p; p = &(*p)->next_job) {
+        if (*p == job) {
+            *p = job->next_job;
+            return;
+        }
+    }
+}
+
+static void *worker_main(void *arg) {
+    huffsig_ctx *ctx = arg;
+
+    umem_thread_start(atomic_fetch_add(&next_tid, 1) % UMEM_MAX_THREADS, UMEM_MAX_THREADS);
+    pthread_mutex_lock(&ctx->lock);
+    while (1) {
+        while (!ctx->stop && !ctx->jobs)
+            pthread_cond_wait(&ctx->work, &ctx->lock);
+        if (ctx->stop)
+            break;
+
+        job_t *job = ctx->jobs;
+        job->helpers++;
+        pthread_mutex_unlock(&ctx->lock);
+        unsigned long counts[SYMBOLS] = { 0 };
+        unsigned long sum = work_on(job, counts);
+        pthread_mutex_lock(&ctx->lock);
+
+        // Every block is claimed by now, whoever gets here first takes the job off the list
+        unlink_job(ctx, job);
+        job->signature = add_hash(job->signature, sum);
+        if (job->counts)
+            merge_counts(job->counts, counts);
+        if (--job->helpers == 0)
+            pthread_cond_broadcast(&ctx->finished);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    umem_thread_finish();
+    return NULL;
+}
+
+static void init_job(job_t *job, const void *buf, size_t len) {
+    job->data = buf;
+    job->len = len;
+    job->num_blocks = (len + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    atomic_init(&job->next, 0);
+    job->signature = 0;
+    job->helpers = 0;
+    job->leaves = NULL;
+    job->ends = NULL;
+    job->counts = NULL;
+    job->next_job = NULL;
+}
+
+// Puts the job at the back of the list and wakes the workers
+static void push_job(huffsig_ctx *ctx, job_t *job) {
+    pthread_mutex_lock(&ctx->lock);
+    job_t **tail = &ctx->jobs;
+    while (*tail)
+        tail = &(*tail)->next_job;
+    *tail = job;
+    pthread_cond_broadcast(&ctx->work);
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+// Hashes the job's unclaimed blocks, then takes it off the list and waits for its helpers
+static unsigned long finish_job(huffsig_ctx *ctx, job_t *job) {
+    unsigned long counts[SYMBOLS] = { 0 };
+    unsigned long sum = work_on(job, counts);
+
+    pthread_mutex_lock(&ctx->lock);
+    unlink_job(ctx, job);
+    job->signature = add_hash(job->signature, sum);
+    if (job->counts)
+        merge_counts(job->counts, counts);
+    while (job->helpers > 0)
+        pthread_cond_wait(&ctx->finished, &ctx->lock);
+    pthread_mutex_unlock(&ctx->lock);
+    return job->signature;
+}
+
+huffsig_ctx *huffsig_create(int num_workers) {
+    pthread_once(&umem_once, umem_setup);
+
+    if (num_workers < 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_workers = cpus > 1 ? (int)cpus - 1 : 0;
+    }
+    if (num_workers > UMEM_MAX_THREADS)
+        num_workers = UMEM_MAX_THREADS;
+
+    huffsig_ctx *ctx = malloc(sizeof(huffsig_ctx) + sizeof(pthread_t) * num_workers);
+    if (!ctx)
+        return NULL;
+    pthread_mutex_init(&ctx->lock, NULL);
+    pthread_cond_init(&ctx->work, NULL);
+    pthread_cond_init(&ctx->finished, NULL);
+    ctx->jobs = NULL;
+    ctx->stop = 0;
+    ctx->num_workers = 0;
+
+    for (int i = 0; i < num_workers; i++) {
+        if (pthread_create(&ctx->workers[i], NULL, worker_main, ctx)) {
+            huffsig_destroy(ctx);
+            return NULL;
+        }
+        ctx->num_workers++;
+    }
+    return ctx;
+}
+
+void huffsig_destroy(huffsig_ctx *ctx) {
+    if (!ctx)
+        return;
+    pthread_mutex_lock(&ctx->lock);
+    ctx->stop = 1;
+    pthread_cond_broadcast(&ctx->work);
+    pthread_mutex_unlock(&ctx->lock);
+    for (int i = 0; i < ctx->num_workers; i++)
+        pthread_join(ctx->workers[i], NULL);
+
+    pthread_cond_destroy(&ctx->finished);
+    pthread_cond_destroy(&ctx->work);
+    pthread_mutex_destroy(&ctx->lock);
+    free(ctx);
+}
+
+// Hashes a job on the calling thread and whichever workers are free
+static unsigned long run_job(huffsig_ctx *ctx, job_t *job) {
+    // A single block isn't worth waking anybody for
+    if (ctx->num_workers == 0 || job->num_blocks <= 1)
+        return work_on(job, job->counts);
+    push_job(ctx, job);
+    return finish_job(ctx, job);
+}
+
+// Hash of one big block, its slices counted by the calling thread and whichever workers are free
+static unsigned long hash_split(huffsig_ctx *ctx, const unsigned char *buf, size_t len) {
+    unsigned long counts[SYMBOLS] = { 0 };
+    job_t job;
+    init_job(&job, buf, len);
+    job.num_blocks = (len + HUFFSIG_SPLIT_SIZE - 1) / HUFFSIG_SPLIT_SIZE;
+    job.counts = counts;
+    run_job(ctx, &job);
+    return hash_tree_slot(counts);
+}
+
+unsigned long huffsig_block(huffsig_ctx *ctx, const void *buf, size_t len) {
+    if (len >= HUFFSIG_SPLIT_SIZE)
+        return hash_split(ctx, buf, len);
+    return hash_block(buf, len);
+}
+
+unsigned long huffsig_buffer(huffsig_ctx *ctx, const void *buf, size_t len) {
+    return huffsig_leaves(ctx, buf, len, NULL);
+}
+
+unsigned long huffsig_leaves(huffsig_ctx *ctx, const void *buf, size_t len, unsigned long *leaves) {
+    job_t job;
+    init_job(&job, buf, len);
+    job.leaves = leaves;
+    return run_job(ctx, &job);
+}
+
+size_t huffsig_cdc_split(const void *buf, size_t len, size_t min, size_t avg, size_t max, size_t *ends,
+                         size_t max_chunks) {
+    cdc_params p;
+    if (!cdc_init(&p, min, avg, max))
+        return 0;
+    return cdc_split(&p, buf, len, ends, max_chunks);
+}
+
+unsigned long huffsig_chunks(huffsig_ctx *ctx, const void *buf, const size_t *ends, size_t num_chunks,
+                             unsigned long *hashes) {
+    job_t job;
+    init_job(&job, buf, num_chunks ? ends[num_chunks - 1] : 0);
+    job.num_blocks = num_chunks;
+    job.leaves = hashes;
+    job.ends = ends;
+    unsigned long sum = run_job(ctx, &job);
+
+    // The job left the big chunks alone, each is a job of its own for everybody
+    for (size_t i = 0; i < num_chunks; i++) {
+        size_t start = i ? ends[i - 1] : 0;
+        if (ends[i] - start < HUFFSIG_SPLIT_SIZE)
+            continue;
+        unsigned long h = hash_split(ctx, (const unsigned char *)buf + start, ends[i] - start);
+        if (hashes)
+            hashes[i] = h;
+        sum = add_hash(sum, h);
+    }
+    return sum;
+}
+
+void huffsig_submit(huffsig_ctx *ctx, huffsig_job *job, const void *buf, size_t len) {
+    init_job(job, buf, len);
+    if (ctx->num_workers > 0 && job->num_blocks > 0)
+        push_job(ctx, job);
+}
+
+unsigned long huffsig_wait(huffsig_ctx *ctx, huffsig_job *job) {
+    return finish_job(ctx, job);
+}
+
+void huffsig_stream_init(huffsig_stream *s) {
+    s->pending_len = 0;
+    s->signature = 0;
+}
+
+void huffsig_update(huffsig_ctx *ctx, huffsig_stream *s, const void *buf, size_t len) {
+    const unsigned char *p = buf;
+
+    // Finish the block the last update started
+    if (s->pending_len > 0) {
+        size_t take = BLOCK_SIZE - s->pending_len < len ? BLOCK_SIZE - s->pending_len : len;
+        memcpy(s->pending + s->pending_len, p, take);
+        s->pending_len += take;
+        p += take;
+        len -= take;
+        if (s->pending_len < BLOCK_SIZE)
+            return;
+        s->signature = add_hash(s->signature, hash_block(s->pending, BLOCK_SIZE));
+        s->pending_len = 0;
+    }
+
+    // Whole blocks straight from the caller's buffer, the rest waits for more
+    size_t whole = len / BLOCK_SIZE * BLOCK_SIZE;
+    if (whole > 0)
+        s->signature = add_hash(s->signature, huffsig_buffer(ctx, p, whole));
+    memcpy(s->pending, p + whole, len - whole);
+    s->pending_len = len - whole;
+}
+
+unsigned long huffsig_finish(huffsig_ctx *ctx, huffsig_stream *s) {
+    (void)ctx;
+    if (s->pending_len > 0) {
+        s->signature = add_hash(s->signature, hash_block(s->pending, s->pending_len));
+        s->pending_len = 0;
+    }
+    return s->signature;
+}
@@ -0,0 +1,131 @@
+#ifndef HUFFSIG_H
+#define HUFFSIG_H
+
+/* `````````````````````````````````````````````````````````````````````
+ * libhuffsig: Huffman Signatures In-Process
+ *
+ * The signatures the hash binaries print, as a library (libhuffsig.a,
+ * libhuffsig.so) that doesn't need a process per file:
+ *
+ *     huffsig_ctx *ctx = huffsig_create(-1);         // workers for the other cores
+ *     unsigned long sig = huffsig_buffer(ctx, data, len);
+ *     huffsig_destroy(ctx);
+ *
+ * huffsig_buffer gives the same signature as `sharedhash <file>` on a
+ * file holding the same bytes: the buffer is cut into HUFFSIG_BLOCK_SIZE
+ * blocks, each is hashed, and the hashes are added modulo
+ * HUFFSIG_PRIME. huffsig_block is the hash of one block of any length,
+ * and huffsig_leaves hands back every block's hash along with the sum.
+ *
+ * Blocks don't have to be HUFFSIG_BLOCK_SIZE: huffsig_cdc_split cuts
+ * data where its content says to (see cdc.h), so chunks before and
+ * after an edit hash the same, and huffsig_chunks hashes any list of
+ * chunks the way huffsig_leaves hashes fixed blocks.
+ * Data arriving in pieces goes through a huffsig_stream, which gives the
+ * same signature as huffsig_buffer on all the pieces put together.
+ * huffsig_submit and huffsig_wait split huffsig_buffer in two, so one
+ * thread can keep many buffers in flight at once (see hashbatch.c).
+ * A block of HUFFSIG_SPLIT_SIZE or more, from huffsig_block or among
+ * huffsig_chunks' chunks, has its symbols counted in slices by the
+ * workers and the caller together before its one tree is built, so even
+ * a few huge blocks keep every core busy.
+ *
+ * Every function may be called from any number of threads at once, on
+ * the same context or different ones, as long as each stream is only
+ * used by one thread at a time. Callers of huffsig_buffer and
+ * huffsig_update hash blocks alongside the context's workers, so a
+ * context with no workers just hashes on the calling thread.
+ *
+ * Nothing is allocated after huffsig_create: tree memory comes from the
+ * library's allocator, a fixed 2 MB heap set up the first time a context
+ * is created and shared by every context in the process, and streams and
+ * pending work live in memory the caller owns. The heap holds the trees
+ * of about a hundred blocks, so however many workers and callers there
+ * are, only 64 trees are built at once and the rest wait their turn.
+ * If the heap still runs out, the signature (and the hash of the block
+ * that failed) is HUFFSIG_ERROR, as is every later signature of a
+ * stream that saw it.
+ */
+
+#include <stddef.h>
+
+#if defined(__GNUC__)
+#define HUFFSIG_API __attribute__((visibility("default")))
+#else
+#define HUFFSIG_API
+#endif
+
+#define HUFFSIG_BLOCK_SIZE 1024
+#define HUFFSIG_PRIME 2147483647UL
+#define HUFFSIG_ERROR ((unsigned long)-1)   // instead of a signature when the heap ran out, signatures are below the prime
+#define HUFFSIG_SPLIT_SIZE (256 * 1024)   // blocks this big are counted in slices of this size in parallel
+
+typedef struct huffsig_ctx huffsig_ctx;
+
+// Signature of data arriving in pieces. Only touch it through the functions below.
+typedef struct {
+    unsigned char pending[HUFFSIG_BLOCK_SIZE];   // the start of a block still waiting for the rest of it
+    size_t pending_len;
+    unsigned long signature;                     // of every whole block so far
+} huffsig_stream;
+
+// One buffer in flight, from huffsig_submit until huffsig_wait returns. Lives wherever the caller likes, but must
+// stay put until then. Only touch it through the functions below.
+typedef struct huffsig_job {
+    const unsigned char *data;
+    size_t len;
+    size_t num_blocks;
+    _Atomic size_t next;           // next block to claim
+    unsigned long signature;       // everything hashed so far, under the context's lock
+    int helpers;                   // workers hashing this job right now, under the context's lock
+    unsigned long *leaves;         // every block's hash, for huffsig_leaves
+    const size_t *ends;            // where each block ends, for huffsig_chunks
+    unsigned long *counts;         // symbol counts of a single big block counted in slices, under the context's lock
+    struct huffsig_job *next_job;
+} huffsig_job;
+
+// A context with num_workers threads of its own. Negative means one fewer than there are online CPUs, since callers
+// hash too. Returns NULL if the threads can't be started.
+HUFFSIG_API huffsig_ctx *huffsig_create(int num_workers);
+
+// Stops and joins the workers. Nothing else may be using ctx.
+HUFFSIG_API void huffsig_destroy(huffsig_ctx *ctx);
+
+// Hash of one block, on the calling thread unless it's HUFFSIG_SPLIT_SIZE or more
+HUFFSIG_API unsigned long huffsig_block(huffsig_ctx *ctx, const void *buf, size_t len);
+
+// Signature of a whole buffer, its blocks shared between the calling thread and the workers
+HUFFSIG_API unsigned long huffsig_buffer(huffsig_ctx *ctx, const void *buf, size_t len);
+
+// huffsig_buffer that also stores the hash of every block, in order, in leaves (one per HUFFSIG_BLOCK_SIZE bytes,
+// rounded up)
+HUFFSIG_API unsigned long huffsig_leaves(huffsig_ctx *ctx, const void *buf, size_t len, unsigned long *leaves);
+
+// Cuts buf into content-defined chunks of min to max bytes, avg on average (min at least 64), and stores where each
+// ends, up to max_chunks of them. Returns how many it stored, 0 if the sizes don't make sense. A buffer needs at most
+// len / min + 1.
+HUFFSIG_API size_t huffsig_cdc_split(const void *buf, size_t len, size_t min, size_t avg, size_t max, size_t *ends,
+                                     size_t max_chunks);
+
+// Hashes chunk i of buf, which ends at ends[i] and starts where chunk i - 1 ended, into hashes[i] (if hashes isn't
+// NULL), and returns the sum of the hashes. Shared with the workers like huffsig_buffer.
+HUFFSIG_API unsigned long huffsig_chunks(huffsig_ctx *ctx, const void *buf, const size_t *ends, size_t num_chunks,
+                                         unsigned long *hashes);
+
+// Hands buf to the workers and returns at once. buf must stay put until huffsig_wait returns.
+HUFFSIG_API void huffsig_submit(huffsig_ctx *ctx, huffsig_job *job, const void *buf, size_t len);
+
+// Hashes whatever blocks of the job are still unclaimed, waits for the workers to finish the rest and returns its
+// signature, the same as huffsig_buffer's. Any thread may wait, but only one, and only once.
+HUFFSIG_API unsigned long huffsig_wait(huffsig_ctx *ctx, huffsig_job *job);
+
+HUFFSIG_API void huffsig_stream_init(huffsig_stream *s);
+
+// Adds the next len bytes. Whole blocks are hashed right away, in parallel like huffsig_buffer.
+HUFFSIG_API void huffsig_update(huffsig_ctx *ctx, huffsig_stream *s, const void *buf, size_t len);
+
+// Hashes whatever is left as the last, short block and returns the signature. The stream can be reused after
+// huffsig_stream_init.
+HUFFSIG_API unsigned long huffsig_finish(huffsig_ctx *ctx, huffsig_stream *s);
+
+#endif
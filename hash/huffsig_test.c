@@ -0,0 +1,77 @@
+/* `````````````````````````````````````````````````````````````````````
+ * libhuffsig Under Many Threads
+ *
+ *     huffsig_test
+ *
+ * Hashes random buffers with far more workers and callers than the
+ * library's heap has room for trees, and checks every signature against
+ * the same buffer hashed block by block on a context with no workers.
+ * Run by ctest.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "huffsig.h"
+
+#define WORKERS 300
+#define CALLERS 8
+#define BUFFER_SIZE (8 << 20)
+
+static huffsig_ctx *ctx;
+static unsigned char *data;
+static unsigned long expected;
+static int failures;
+static pthread_mutex_t failures_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void check(const char *what, unsigned long got) {
+    if (got == expected)
+        return;
+    fprintf(stderr, "%s: %lu, expected %lu\n", what, got, expected);
+    pthread_mutex_lock(&failures_lock);
+    failures++;
+    pthread_mutex_unlock(&failures_lock);
+}
+
+static void *caller(void *arg) {
+    (void)arg;
+    check("huffsig_buffer from a caller thread", huffsig_buffer(ctx, data, BUFFER_SIZE));
+    return NULL;
+}
+
+int main(void) {
+    data = malloc(BUFFER_SIZE);
+    if (!data)
+        return 1;
+    srand(1);
+    for (size_t i = 0; i < BUFFER_SIZE; i++)
+        data[i] = (unsigned char)rand();
+
+    huffsig_ctx *single = huffsig_create(0);
+    if (!single)
+        return 1;
+    for (size_t off = 0; off < BUFFER_SIZE; off += HUFFSIG_BLOCK_SIZE)
+        expected = (expected + huffsig_block(single, data + off, HUFFSIG_BLOCK_SIZE)) % HUFFSIG_PRIME;
+    huffsig_destroy(single);
+
+    ctx = huffsig_create(WORKERS);
+    if (!ctx) {
+        fprintf(stderr, "can't start %d workers\n", WORKERS);
+        return 1;
+    }
+    check("huffsig_buffer", huffsig_buffer(ctx, data, BUFFER_SIZE));
+
+    pthread_t threads[CALLERS];
+    for (int i = 0; i < CALLERS; i++)
+        pthread_create(&threads[i], NULL, caller, NULL);
+    for (int i = 0; i < CALLERS; i++)
+        pthread_join(threads[i], NULL);
+    huffsig_destroy(ctx);
+
+    free(data);
+    if (failures)
+        return 1;
+    printf("%d workers and %d callers agree: %lu\n", WORKERS, CALLERS, expected);
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "huffman.h"
+#include "umem.h"
+
+/* `````````````````````````````````````````````````````````````````````
+ * Main Entry Point
+ *
+ * Parses arguments to determine execution mode, initializes the
+ * allocator, then dispatches to either single-threaded execution, the
+ * parallel executor this binary was built with, or run_auto to choose.
+ *
+ * The allocator MUST be initialized before any fork() calls or threads,
+ * so every worker starts from the same heap.
+ */
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file> [-t | --auto]\n", argv[0]);
+        return 1;
+    }
+
+    const char *filename = argv[1];
+    if (argc >= 3 && strcmp(argv[2], "--auto") == 0) {
+        // Calibration and the parallel run both need the allocator in its multi-threaded mode
+        use_multiprocess = 1;
+        init_umem();
+        return run_auto(filename);
+    }
+
+    use_multiprocess = (argc >= 3 && strcmp(argv[2], "-m") == 0) || (argc >= 3 && strcmp(argv[2], "-t") == 0);
+
+    init_umem();
+
+    if (use_multiprocess)
+        return run_threads(filename);
+    else
+        return run_single(filename);
+}
+
+int run_single(const char *filename) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        perror("fopen");
+        return 1;
+    }
+
+    unsigned char buf[BLOCK_SIZE];
+    unsigned long final_hash = 0;
+    int block_num = 0;
+
+    while (!feof(fp)) {
+        size_t n = fread(buf, 1, BLOCK_SIZE, fp);
+        if (n == 0) break;
+        unsigned long h = process_block(buf, n);
+        print_intermediate(block_num++, h, getpid());
+        final_hash = add_hash(final_hash, h);
+    }
+
+    fclose(fp);
+    return print_final(final_hash);
+}
@@ -0,0 +1,322 @@
+#include "tlsf.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* =======================================================================
+   Size Classes
+   ======================================================================= */
+
+#define TLSF_ALIGN_LOG2 4
+#define TLSF_ALIGN (1 << TLSF_ALIGN_LOG2)      // same 16 bytes as the umalloc variants
+#define TLSF_SL_LOG2 4
+#define TLSF_SL_COUNT (1 << TLSF_SL_LOG2)
+
+// Sizes below SMALL_BLOCK all share first level 0, split linearly into TLSF_SL_COUNT lists
+#define TLSF_FL_SHIFT (TLSF_SL_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_SMALL_BLOCK (1 << TLSF_FL_SHIFT)
+#define TLSF_FL_MAX 32                          // largest block is just under 4 GB, one bitmap bit per level
+#define TLSF_FL_COUNT (TLSF_FL_MAX - TLSF_FL_SHIFT + 1)
+
+#define ALIGN_UP(x) (((x) + (TLSF_ALIGN - 1)) & ~(size_t)(TLSF_ALIGN - 1))
+
+/* =======================================================================
+   Blocks
+   ======================================================================= */
+
+// Every block starts with a header naming its physical predecessor and its payload size. The two low bits of the
+// size, which are always zero since sizes are aligned, say whether this block and the one before it are free. Free
+// blocks also link into their size class through the first two words of the payload.
+typedef struct tlsf_block {
+    struct tlsf_block *prev_phys;
+    size_t size;
+    struct tlsf_block *next_free;
+    struct tlsf_block *prev_free;
+} block_t;
+
+#define BLOCK_FREE ((size_t)1)
+#define BLOCK_PREV_FREE ((size_t)2)
+#define BLOCK_HEADER offsetof(block_t, next_free)
+#define BLOCK_MIN (sizeof(block_t) - BLOCK_HEADER)   // room for the free links
+#define BLOCK_MAX ((size_t)1 << TLSF_FL_MAX)
+
+struct tlsf {
+    unsigned fl_bitmap;
+    unsigned sl_bitmap[TLSF_FL_COUNT];
+    block_t *blocks[TLSF_FL_COUNT][TLSF_SL_COUNT];
+};
+
+static size_t block_size(const block_t *b) {
+    return b->size & ~(BLOCK_FREE | BLOCK_PREV_FREE);
+}
+
+static void block_set_size(block_t *b, size_t size) {
+    b->size = size | (b->size & (BLOCK_FREE | BLOCK_PREV_FREE));
+}
+
+static int block_is_free(const block_t *b) {
+    return (b->size & BLOCK_FREE) != 0;
+}
+
+static int block_prev_is_free(const block_t *b) {
+    return (b->size & BLOCK_PREV_FREE) != 0;
+}
+
+static void *block_payload(const block_t *b) {
+    return (char *)b + BLOCK_HEADER;
+}
+
+static block_t *block_from_payload(const void *ptr) {
+    return (block_t *)((char *)ptr - BLOCK_HEADER);
+}
+
+static block_t *block_next(const block_t *b) {
+    return (block_t *)((char *)block_payload(b) + block_size(b));
+}
+
+// Marks b free or used, which the next block records as its predecessor's state
+static void block_mark(block_t *b, int free) {
+    block_t *next = block_next(b);
+    if (free) {
+        b->size |= BLOCK_FREE;
+        next->size |= BLOCK_PREV_FREE;
+        next->prev_phys = b;
+    } else {
+        b->size &= ~BLOCK_FREE;
+        next->size &= ~BLOCK_PREV_FREE;
+    }
+}
+
+/* =======================================================================
+   Class Lookup
+   ======================================================================= */
+
+static int fls_size(size_t x) {
+    return (int)(sizeof(unsigned long long) * 8) - 1 - __builtin_clzll((unsigned long long)x);
+}
+
+static int ffs_bits(unsigned x) {
+    return __builtin_ctz(x);
+}
+
+// Class holding blocks of exactly this size
+static void mapping_insert(size_t size, int *fl, int *sl) {
+    if (size < TLSF_SMALL_BLOCK) {
+        *fl = 0;
+        *sl = (int)(size / (TLSF_SMALL_BLOCK / TLSF_SL_COUNT));
+    } else {
+        int f = fls_size(size);
+        *sl = (int)(size >> (f - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;
+        *fl = f - (TLSF_FL_SHIFT - 1);
+    }
+}
+
+// First class whose every block is at least size, so whatever list search_suitable finds can be used without looking
+static void mapping_search(size_t size, int *fl, int *sl) {
+    if (size >= TLSF_SMALL_BLOCK)
+        size += ((size_t)1 << (fls_size(size) - TLSF_SL_LOG2)) - 1;
+    mapping_insert(size, fl, sl);
+}
+
+static block_t *search_suitable(tlsf_t t, int *fl, int *sl) {
+    unsigned sl_map = t->sl_bitmap[*fl] & (~0U << *sl);
+    if (!sl_map) {
+        unsigned fl_map = *fl + 1 < 32 ? t->fl_bitmap & (~0U << (*fl + 1)) : 0;
+        if (!fl_map)
+            return NULL;
+        *fl = ffs_bits(fl_map);
+        sl_map = t->sl_bitmap[*fl];
+    }
+    *sl = ffs_bits(sl_map);
+    return t->blocks[*fl][*sl];
+}
+
+static void insert_free(tlsf_t t, block_t *b) {
+    int fl, sl;
+    mapping_insert(block_size(b), &fl, &sl);
+    block_t *head = t->blocks[fl][sl];
+    b->next_free = head;
+    b->prev_free = NULL;
+    if (head)
+        head->prev_free = b;
+    t->blocks[fl][sl] = b;
+    t->fl_bitmap |= 1U << fl;
+    t->sl_bitmap[fl] |= 1U << sl;
+}
+
+static void remove_free(tlsf_t t, block_t *b) {
+    int fl, sl;
+    mapping_insert(block_size(b), &fl, &sl);
+    if (b->prev_free)
+        b->prev_free->next_free = b->next_free;
+    else
+        t->blocks[fl][sl] = b->next_free;
+    if (b->next_free)
+        b->next_free->prev_free = b->prev_free;
+
+    if (!t->blocks[fl][sl]) {
+        t->sl_bitmap[fl] &= ~(1U << sl);
+        if (!t->sl_bitmap[fl])
+            t->fl_bitmap &= ~(1U << fl);
+    }
+}
+
+/* =======================================================================
+   Instance and Pools
+   ======================================================================= */
+
+size_t tlsf_size(void) {
+    return ALIGN_UP(sizeof(struct tlsf));
+}
+
+size_t tlsf_pool_overhead(void) {
+    return 2 * BLOCK_HEADER;   // the first block's header and the sentinel at the end
+}
+
+tlsf_t tlsf_create(void *mem) {
+    tlsf_t t = mem;
+    memset(t, 0, sizeof(struct tlsf));
+    return t;
+}
+
+tlsf_t tlsf_create_with_pool(void *mem, size_t bytes) {
+    tlsf_t t = tlsf_create(mem);
+    if (bytes > tlsf_size())
+        tlsf_add_pool(t, (char *)mem + tlsf_size(), bytes - tlsf_size());
+    return t;
+}
+
+int tlsf_add_pool(tlsf_t t, void *mem, size_t bytes) {
+    // Line the payloads up on TLSF_ALIGN, whatever alignment mem has
+    char *start = (char *)ALIGN_UP((uintptr_t)mem + BLOCK_HEADER) - BLOCK_HEADER;
+    size_t lost = start - (char *)mem;
+    if (bytes < lost + tlsf_pool_overhead() + BLOCK_MIN)
+        return 0;
+    size_t size = (bytes - lost - tlsf_pool_overhead()) & ~(size_t)(TLSF_ALIGN - 1);
+    if (size < BLOCK_MIN)
+        return 0;
+    if (size >= BLOCK_MAX)
+        size = BLOCK_MAX - TLSF_ALIGN;
+
+    block_t *b = (block_t *)start;
+    b->prev_phys = NULL;
+    b->size = size;
+
+    // A zero-size block that is never free closes off the pool so merging never runs past the end
+    block_t *sentinel = block_next(b);
+    sentinel->size = 0;
+    block_mark(b, 1);
+    insert_free(t, b);
+    return 1;
+}
+
+/* =======================================================================
+   Allocation
+   ======================================================================= */
+
+// Cuts a free block (already off its list) down to size and returns the rest of it to the lists
+static void split(tlsf_t t, block_t *b, size_t size) {
+    if (block_size(b) < size + BLOCK_HEADER + BLOCK_MIN)
+        return;
+
+    block_t *rest = (block_t *)((char *)block_payload(b) + size);
+    rest->size = block_size(b) - size - BLOCK_HEADER;
+    rest->prev_phys = b;
+    block_set_size(b, size);
+    block_mark(rest, 1);
+    insert_free(t, rest);
+}
+
+// Rounds a request up to what a block actually holds. Returns 0 for sizes no block can hold.
+static size_t adjust_size(size_t size) {
+    if (size == 0 || size >= BLOCK_MAX)
+        return 0;
+    size = ALIGN_UP(size);
+    return size < BLOCK_MIN ? BLOCK_MIN : size;
+}
+
+// Takes a free block of at least size bytes off its list
+static block_t *locate_free(tlsf_t t, size_t size) {
+    int fl, sl;
+    mapping_search(size, &fl, &sl);
+    if (fl >= TLSF_FL_COUNT)
+        return NULL;
+    block_t *b = search_suitable(t, &fl, &sl);
+    if (b)
+        remove_free(t, b);
+    return b;
+}
+
+void *tlsf_malloc(tlsf_t t, size_t size) {
+    size = adjust_size(size);
+    if (!size)
+        return NULL;
+    block_t *b = locate_free(t, size);
+    if (!b)
+        return NULL;
+
+    split(t, b, size);
+    block_mark(b, 0);
+    return block_payload(b);
+}
+
+void *tlsf_memalign(tlsf_t t, size_t align, size_t size) {
+    if (align <= TLSF_ALIGN)
+        return tlsf_malloc(t, size);
+    size = adjust_size(size);
+    if (!size || size + align + sizeof(block_t) >= BLOCK_MAX)
+        return NULL;
+
+    // Room to slide the payload up to the boundary, with whatever gets skipped big enough to be a free block itself
+    block_t *b = locate_free(t, size + align + sizeof(block_t));
+    if (!b)
+        return NULL;
+
+    char *payload = block_payload(b);
+    char *aligned = (char *)(((uintptr_t)payload + align - 1) & ~(uintptr_t)(align - 1));
+    if (aligned != payload && (size_t)(aligned - payload) < sizeof(block_t))
+        aligned += align;
+    size_t gap = aligned - payload;
+
+    if (gap) {
+        // Turn the skipped part into a free block of its own and start the allocation after it
+        block_t *rest = (block_t *)(aligned - BLOCK_HEADER);
+        rest->size = block_size(b) - gap;
+        block_set_size(b, gap - BLOCK_HEADER);
+        block_mark(b, 1);
+        insert_free(t, b);
+        b = rest;
+    }
+
+    split(t, b, size);
+    block_mark(b, 0);
+    return block_payload(b);
+}
+
+size_t tlsf_block_size(const void *ptr) {
+    return ptr ? block_size(block_from_payload(ptr)) : 0;
+}
+
+void tlsf_free(tlsf_t t, void *ptr) {
+    if (!ptr)
+        return;
+    block_t *b = block_from_payload(ptr);
+    block_mark(b, 1);
+
+    // Merge with both physical neighbours right away, so free memory is never fragmented into adjacent blocks
+    if (block_prev_is_free(b)) {
+        block_t *prev = b->prev_phys;
+        remove_free(t, prev);
+        block_set_size(prev, block_size(prev) + BLOCK_HEADER + block_size(b));
+        b = prev;
+        block_mark(b, 1);
+    }
+    block_t *next = block_next(b);
+    if (block_is_free(next)) {
+        remove_free(t, next);
+        block_set_size(b, block_size(b) + BLOCK_HEADER + block_size(next));
+        block_mark(b, 1);
+    }
+
+    insert_free(t, b);
+}
@@ -0,0 +1,48 @@
+#ifndef TLSF_H
+#define TLSF_H
+
+/* `````````````````````````````````````````````````````````````````````
+ * Two-Level Segregated Fit allocator
+ *
+ * Free blocks are kept in size classes picked by two indices: the first
+ * level is the power of two just below the size, the second level splits
+ * that range into TLSF_SL_COUNT equal parts. A bitmap per level records
+ * which lists are non-empty, so finding a big enough block is a couple of
+ * find-first-set instructions instead of a list walk, and a freed block
+ * merges with its physical neighbours right away through the boundary
+ * tags. Both tlsf_malloc and tlsf_free run in constant time no matter how
+ * fragmented the heap is.
+ *
+ * An instance manages one or more pools of caller-provided memory and is
+ * not thread-safe; callers that share one take their own lock.
+ */
+
+#include <stddef.h>
+
+typedef struct tlsf *tlsf_t;
+
+// Bytes at the start of the memory given to tlsf_create that hold the instance itself
+size_t tlsf_size(void);
+
+// Bytes a pool loses to block bookkeeping
+size_t tlsf_pool_overhead(void);
+
+// Sets up an instance in mem, which must be at least tlsf_size() bytes
+tlsf_t tlsf_create(void *mem);
+
+// Sets up an instance at the start of mem and hands the rest of it over as the first pool
+tlsf_t tlsf_create_with_pool(void *mem, size_t bytes);
+
+// Adds bytes of memory at mem as another pool. Returns 0 if it's too small to hold a block.
+int tlsf_add_pool(tlsf_t tlsf, void *mem, size_t bytes);
+
+void *tlsf_malloc(tlsf_t tlsf, size_t size);
+void tlsf_free(tlsf_t tlsf, void *ptr);
+
+// Memory whose address is a multiple of align, which must be a power of two
+void *tlsf_memalign(tlsf_t tlsf, size_t align, size_t size);
+
+// Usable bytes at ptr, at least what was asked for
+size_t tlsf_block_size(const void *ptr);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef UBACKEND_H
+#define UBACKEND_H
+
+/* `````````````````````````````````````````````````````````````````````
+ * Allocator Backends for the Benchmark and Replay Tools
+ *
+ * allocbench and ureplay call whichever umem_*.c backend they were
+ * linked with (see umem.h and CMakeLists.txt) through these functions.
+ * Threads and pool resets go through the backend's umem_* hooks, the
+ * same way the hash executors use them. One define changes how it is
+ * driven:
+ *
+ *   BENCH_SERIALIZE  the backend isn't thread-safe (umem_firstfit.c),
+ *                    so every call takes one lock here
+ */
+
+#include <pthread.h>
+
+#include "umem.h"
+
+#if defined(BENCH_SERIALIZE)
+
+static pthread_mutex_t bench_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline void bench_init(void) {
+    init_umem();
+}
+
+static inline void *bench_alloc(size_t size) {
+    pthread_mutex_lock(&bench_lock);
+    void *p = umalloc(size);
+    pthread_mutex_unlock(&bench_lock);
+    return p;
+}
+
+static inline void bench_free(void *ptr) {
+    pthread_mutex_lock(&bench_lock);
+    ufree(ptr);
+    pthread_mutex_unlock(&bench_lock);
+}
+
+#else
+
+static inline void bench_init(void) {
+    use_multiprocess = 1;
+    init_umem();
+}
+
+static inline void *bench_alloc(size_t size) { return umalloc(size); }
+static inline void bench_free(void *ptr) { ufree(ptr); }
+
+#endif
+
+static inline void bench_thread_init(int tid, int num_threads) { umem_thread_start(tid, num_threads); }
+static inline void bench_pool_reset(void) { umem_block_start(); }
+
+#endif
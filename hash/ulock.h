@@ -0,0 +1,284 @@
+#ifndef ULOCK_H
+#define ULOCK_H
+
+/* `````````````````````````````````````````````````````````````````````
+ * Allocator Locks
+ *
+ * The locks guarding allocator state, with the kind picked at compile
+ * time:
+ *
+ *   (default)       pthread_mutex_t
+ *   ULOCK_ADAPTIVE  spins on the lock word for a while before sleeping
+ *                   on it with futex. umalloc's critical sections are
+ *                   short enough that the holder is usually done before
+ *                   a waiter would have finished going to sleep.
+ *   ULOCK_MCS       MCS queue lock. Waiters line up and each spins (and
+ *                   then sleeps) on its own queue node, so a release
+ *                   only touches the next waiter's cache line and the
+ *                   lock changes hands in arrival order instead of to
+ *                   whoever wins the race. The strict order is also its
+ *                   weakness when threads outnumber cores: the lock
+ *                   waits for its next owner to be scheduled, and with
+ *                   a thread per block every block's tree is kept
+ *                   alive at once (sharedhash runs out of heap on
+ *                   random input). Try it with allocbench first.
+ *
+ * Building with ULOCK_STATS also counts acquisitions, how many had to
+ * wait, and the time spent waiting for and holding each lock, which
+ * ulock_report prints.
+ *
+ * MCS locks a thread holds at the same time must be released in the
+ * reverse order they were taken, since each thread keeps its queue
+ * nodes on a small stack. Every lock in the allocators nests that way.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+
+#if defined(ULOCK_ADAPTIVE) || defined(ULOCK_MCS)
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define ULOCK_SPIN 128      // tries before a waiter goes to sleep
+#define ULOCK_MAX_HELD 8    // MCS locks one thread can hold at once
+
+#ifdef ULOCK_STATS
+typedef struct {
+    unsigned long acquisitions;
+    unsigned long contended;
+    unsigned long wait_ns;
+    unsigned long max_wait_ns;
+    unsigned long hold_ns;
+    unsigned long held_since;   // only the holder touches any of these, so they need no atomics
+} ulock_stats_t;
+#define ULOCK_STATS_FIELD ulock_stats_t stats;
+#else
+#define ULOCK_STATS_FIELD
+#endif
+
+static inline void ulock_pause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+#if defined(ULOCK_ADAPTIVE) || defined(ULOCK_MCS)
+static inline void ulock_futex_wait(_Atomic int *word, int value) {
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+static inline void ulock_futex_wake(_Atomic int *word) {
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+#endif
+
+/* =======================================================================
+   Lock Kinds
+   -----------------------------------------------------------------------
+   Each kind provides ulock_t, ULOCK_INITIALIZER, ulock_init, and
+   ulock_acquire/ulock_release. ulock_acquire returns non-zero if the
+   lock was held by someone else when it was asked for.
+   ======================================================================= */
+
+#if defined(ULOCK_ADAPTIVE)
+
+#define ULOCK_KIND "adaptive"
+
+// state is 0 when free, 1 when held, 2 when held and somebody may be asleep waiting for it
+typedef struct {
+    _Atomic int state;
+    ULOCK_STATS_FIELD
+} ulock_t;
+
+#define ULOCK_INITIALIZER { 0 }
+
+static inline void ulock_init(ulock_t *l) {
+    atomic_init(&l->state, 0);
+}
+
+static inline int ulock_acquire(ulock_t *l) {
+    int c = 0;
+    if (atomic_compare_exchange_strong(&l->state, &c, 1))
+        return 0;
+
+    for (int i = 0; i < ULOCK_SPIN; i++) {
+        ulock_pause();
+        c = 0;
+        if (atomic_load_explicit(&l->state, memory_order_relaxed) == 0 &&
+            atomic_compare_exchange_weak(&l->state, &c, 1))
+            return 1;
+    }
+
+    // Taking it as 2 rather than 1 once we've slept is what keeps release waking the ones still asleep
+    while ((c = atomic_exchange(&l->state, 2)) != 0)
+        ulock_futex_wait(&l->state, 2);
+    return 1;
+}
+
+static inline void ulock_release(ulock_t *l) {
+    if (atomic_exchange(&l->state, 0) == 2)
+        ulock_futex_wake(&l->state);
+}
+
+#elif defined(ULOCK_MCS)
+
+#define ULOCK_KIND "mcs"
+
+typedef struct ulock_node {
+    _Atomic(struct ulock_node *) next;
+    _Atomic int waiting;   // 1 spinning, 2 asleep, 0 once the lock has been handed over
+} ulock_node_t;
+
+typedef struct {
+    _Atomic(ulock_node_t *) tail;
+    ulock_node_t *holder;   // the holder's node, for release to find its successor
+    ULOCK_STATS_FIELD
+} ulock_t;
+
+#define ULOCK_INITIALIZER { NULL, NULL }
+
+static __thread ulock_node_t ulock_nodes[ULOCK_MAX_HELD];
+static __thread int ulock_held;
+
+static inline void ulock_init(ulock_t *l) {
+    atomic_init(&l->tail, NULL);
+    l->holder = NULL;
+}
+
+static inline int ulock_acquire(ulock_t *l) {
+    ulock_node_t *me = &ulock_nodes[ulock_held++];
+    atomic_store_explicit(&me->next, NULL, memory_order_relaxed);
+    atomic_store_explicit(&me->waiting, 1, memory_order_relaxed);
+
+    ulock_node_t *prev = atomic_exchange(&l->tail, me);
+    if (!prev) {
+        l->holder = me;
+        return 0;
+    }
+
+    atomic_store_explicit(&prev->next, me, memory_order_release);
+    for (int i = 0; i < ULOCK_SPIN && atomic_load_explicit(&me->waiting, memory_order_acquire); i++)
+        ulock_pause();
+    int spinning = 1;
+    if (atomic_compare_exchange_strong(&me->waiting, &spinning, 2)) {
+        while (atomic_load_explicit(&me->waiting, memory_order_acquire))
+            ulock_futex_wait(&me->waiting, 2);
+    }
+    l->holder = me;
+    return 1;
+}
+
+static inline void ulock_release(ulock_t *l) {
+    ulock_node_t *me = l->holder;
+    ulock_node_t *next = atomic_load_explicit(&me->next, memory_order_acquire);
+    if (!next) {
+        ulock_node_t *expected = me;
+        if (atomic_compare_exchange_strong(&l->tail, &expected, NULL)) {
+            ulock_held--;
+            return;
+        }
+        // Someone swapped themselves in as the tail but hasn't linked up behind us yet
+        for (int i = 0; !(next = atomic_load_explicit(&me->next, memory_order_acquire)); i++) {
+            if (i < ULOCK_SPIN)
+                ulock_pause();
+            else
+                sched_yield();
+        }
+    }
+
+    if (atomic_exchange_explicit(&next->waiting, 0, memory_order_release) == 2)
+        ulock_futex_wake(&next->waiting);
+    ulock_held--;
+}
+
+#else
+
+#define ULOCK_KIND "pthread"
+
+typedef struct {
+    pthread_mutex_t mutex;
+    ULOCK_STATS_FIELD
+} ulock_t;
+
+#define ULOCK_INITIALIZER { PTHREAD_MUTEX_INITIALIZER }
+
+static inline void ulock_init(ulock_t *l) {
+    pthread_mutex_init(&l->mutex, NULL);
+}
+
+static inline int ulock_acquire(ulock_t *l) {
+#ifdef ULOCK_STATS
+    if (pthread_mutex_trylock(&l->mutex) == 0)
+        return 0;
+#endif
+    pthread_mutex_lock(&l->mutex);
+    return 1;
+}
+
+static inline void ulock_release(ulock_t *l) {
+    pthread_mutex_unlock(&l->mutex);
+}
+
+#endif
+
+/* =======================================================================
+   Locking and Statistics
+   ======================================================================= */
+
+#ifdef ULOCK_STATS
+
+static inline unsigned long ulock_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+static inline void ulock_lock(ulock_t *l) {
+    unsigned long start = ulock_now();
+    int contended = ulock_acquire(l);
+    unsigned long now = ulock_now();
+
+    ulock_stats_t *s = &l->stats;
+    s->acquisitions++;
+    s->contended += contended;
+    s->wait_ns += now - start;
+    if (now - start > s->max_wait_ns)
+        s->max_wait_ns = now - start;
+    s->held_since = now;
+}
+
+static inline void ulock_unlock(ulock_t *l) {
+    l->stats.hold_ns += ulock_now() - l->stats.held_since;
+    ulock_release(l);
+}
+
+// One line per lock on stderr, so it doesn't mix with the signature on stdout. Locks never taken print nothing.
+static inline void ulock_report(const char *name, const ulock_t *l) {
+    const ulock_stats_t *s = &l->stats;
+    if (!s->acquisitions)
+        return;
+    fprintf(stderr, "%-16s %-8s %10lu taken %6.2f%% contended  wait avg %6lu ns max %9lu ns  hold avg %6lu ns\n",
+            name, ULOCK_KIND, s->acquisitions, 100.0 * s->contended / s->acquisitions, s->wait_ns / s->acquisitions,
+            s->max_wait_ns, s->hold_ns / s->acquisitions);
+}
+
+#else
+
+static inline void ulock_lock(ulock_t *l) {
+    ulock_acquire(l);
+}
+
+static inline void ulock_unlock(ulock_t *l) {
+    ulock_release(l);
+}
+
+#endif
+
+#endif
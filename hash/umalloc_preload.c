@@ -0,0 +1,167 @@
+/* `````````````````````````````````````````````````````````````````````
+ * umalloc as malloc
+ *
+ * Builds the TLSF allocator from tlsf.c into a shared library that
+ * replaces the C library's malloc family, so any program can run on it
+ * without being rebuilt:
+ *
+ *     LD_PRELOAD=./libumalloc_preload.so ./some_program
+ *
+ * Memory comes from pools mmap'd on demand (POOL_SIZE at a time, or one
+ * pool sized to fit for bigger requests) and added to a single TLSF
+ * instance. Pools are never unmapped, but pages nobody has touched don't
+ * count towards RSS.
+ *
+ * One mutex protects the instance. It is taken around fork() through
+ * pthread_atfork, so the child never inherits it locked by a thread that
+ * no longer exists.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "tlsf.h"
+
+#define POOL_SIZE (64 * 1024 * 1024)
+
+static pthread_mutex_t umem_lock = PTHREAD_MUTEX_INITIALIZER;
+static tlsf_t umem_tlsf;
+
+// Maps a new pool able to hold at least size bytes and gives it to the instance. Called with umem_lock held.
+static int grow(size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t bytes = size + tlsf_pool_overhead() + (umem_tlsf ? 0 : tlsf_size()) + page;
+    if (bytes < size)
+        return 0;
+    bytes = bytes < POOL_SIZE ? POOL_SIZE : (bytes + page - 1) & ~(page - 1);
+
+    void *mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        return 0;
+    if (!umem_tlsf) {
+        umem_tlsf = tlsf_create_with_pool(mem, bytes);
+        return 1;
+    }
+    return tlsf_add_pool(umem_tlsf, mem, bytes);
+}
+
+// TLSF rounds requests up to the bottom of the next size class, so a new pool needs about twice the request to be
+// sure the search finds it
+static size_t grow_size(size_t size, size_t align) {
+    size_t need = size + align;
+    return need * 2 > need ? need * 2 : need;
+}
+
+static void *allocate(size_t align, size_t size) {
+    if (size == 0)
+        size = 1;   // malloc(0) hands back a unique pointer
+
+    pthread_mutex_lock(&umem_lock);
+    void *p = umem_tlsf ? tlsf_memalign(umem_tlsf, align, size) : NULL;
+    if (!p && grow(grow_size(size, align)))
+        p = tlsf_memalign(umem_tlsf, align, size);
+    pthread_mutex_unlock(&umem_lock);
+
+    if (!p)
+        errno = ENOMEM;
+    return p;
+}
+
+void *malloc(size_t size) {
+    return allocate(0, size);
+}
+
+void free(void *ptr) {
+    if (!ptr)
+        return;
+    pthread_mutex_lock(&umem_lock);
+    tlsf_free(umem_tlsf, ptr);
+    pthread_mutex_unlock(&umem_lock);
+}
+
+void *calloc(size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    void *p = allocate(0, count * size);
+    if (p)
+        memset(p, 0, count * size);
+    return p;
+}
+
+void *realloc(void *ptr, size_t size) {
+    if (!ptr)
+        return malloc(size);
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+
+    // Blocks only ever grow by moving, and shrinking keeps the block as it is
+    size_t have = tlsf_block_size(ptr);
+    if (size <= have)
+        return ptr;
+    void *p = malloc(size);
+    if (p) {
+        memcpy(p, ptr, have);
+        free(ptr);
+    }
+    return p;
+}
+
+int posix_memalign(void **out, size_t align, size_t size) {
+    if (align < sizeof(void *) || (align & (align - 1)))
+        return EINVAL;
+    void *p = allocate(align, size);
+    if (!p)
+        return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+void *memalign(size_t align, size_t size) {
+    if (align & (align - 1)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return allocate(align, size);
+}
+
+void *aligned_alloc(size_t align, size_t size) {
+    return memalign(align, size);
+}
+
+void *valloc(size_t size) {
+    return allocate((size_t)sysconf(_SC_PAGESIZE), size);
+}
+
+void *pvalloc(size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return allocate(page, (size + page - 1) & ~(page - 1));
+}
+
+size_t malloc_usable_size(void *ptr) {
+    return tlsf_block_size(ptr);
+}
+
+/* =======================================================================
+   Fork Safety
+   ======================================================================= */
+
+static void before_fork(void) {
+    pthread_mutex_lock(&umem_lock);
+}
+
+static void after_fork(void) {
+    pthread_mutex_unlock(&umem_lock);
+}
+
+__attribute__((constructor))
+static void umem_preload_init(void) {
+    pthread_atfork(before_fork, after_fork, after_fork);
+}
@@ -0,0 +1,65 @@
+#ifndef UMEM_H
+#define UMEM_H
+
+/* `````````````````````````````````````````````````````````````````````
+ * Allocator Backends
+ *
+ * Every hash binary links exactly one of these, which decides what
+ * umalloc and ufree do:
+ *
+ *   umem_firstfit.c  first fit over a 128 KB mmap, not thread-safe, so
+ *                    only the processes executor uses it (hash)
+ *   umem_shared.c    first fit under one lock, frees of another thread's
+ *                    chunks go back to it lock-free (sharedhash)
+ *   umem_tlsf.c      Two-Level Segregated Fit under one lock
+ *                    (sharedhash_tlsf)
+ *   umem_pools.c     a bump pool per thread in front of umem_shared's
+ *                    free list (esharedhash)
+ *   umem_slab.c      headerless slabs for the Huffman objects plus
+ *                    per-size first-fit lists (esharedhash_b)
+ *   umem_system.c    the C library's malloc and free
+ *
+ * The lock kind is picked with ulock.h's defines, independently of the
+ * backend.
+ *
+ * Executors tell the backend about threads, blocks and forks through the
+ * umem_* hooks. None of them are on the hot path, and a backend that
+ * doesn't care about one leaves it empty.
+ */
+
+#include <stddef.h>
+
+#define UMEM_MAX_THREADS 1024   // highest tid umem_thread_start is given, plus one
+
+// Non-zero when blocks are hashed in parallel, backends skip their locks otherwise
+extern int use_multiprocess;
+
+// The backend's name, as in umem_<name>.c, which run_auto keeps its profile under
+extern const char umem_name[];
+
+void *init_umem(void);
+void *umalloc(size_t size);
+void ufree(void *ptr);
+
+// Memory starting on a multiple of alignment (a power of two), for backends that define UMEM_HAS_MEMALIGN
+void *umemalign(size_t alignment, size_t size);
+
+// A thread is about to hash blocks as thread tid of num_threads
+void umem_thread_start(int tid, int num_threads);
+
+// The calling thread is starting another block, and nothing it allocated for the last one is still live
+void umem_block_start(void);
+
+// The calling thread is done hashing
+void umem_thread_finish(void);
+
+// Every thread that hashed blocks has been joined
+void umem_threads_done(void);
+
+// Runs in a child process right after fork
+void umem_fork_child(void);
+
+// Prints whatever the backend counted (lock statistics, pool use) after the signature
+void umem_report(void);
+
+#endif
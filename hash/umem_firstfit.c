@@ -0,0 +1,158 @@
+/* `````````````````````````````````````````````````````````````````````
+ * First-Fit Backend
+ *
+ * The original single-process allocator: a first-fit free list inside a
+ * 128 KB region from mmap. Freed chunks go back on the front of the list
+ * and are never coalesced. Nothing here takes a lock, so it only runs
+ * under the processes executor, where every child gets a fresh heap of
+ * its own.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include "umem.h"
+
+#define UMEM_SIZE (128 * 1024)   // 128 KB managed heap for Step 2
+
+#define MAGIC 0xDEADBEEFLL  // integrity check pattern
+
+typedef struct {
+    long size;   // Size of the block (payload only)
+    long magic;  // Magic number for integrity check
+} header_t;
+
+typedef struct __node_t {
+    long size;               // Size of the free block
+    struct __node_t *next;   // Pointer to the next free block
+} node_t;
+
+int use_multiprocess = 0;
+const char umem_name[] = "firstfit";
+
+static void* heap = NULL;
+static node_t* free_list = NULL;
+
+static void *map_umem(void) {
+    void *ptr = mmap(NULL, UMEM_SIZE,
+                     PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+    return ptr;
+}
+
+// Maps the heap and puts all of it on the free list. umalloc does this itself if it finds no heap.
+void *init_umem(void) {
+    heap = map_umem();
+    if (heap == NULL) {
+        fprintf(stderr, "Error: Failed to allocate memory.\n");
+        return NULL;
+    }
+
+    // Initialize the first node in the list with all memory (minus size of the node)
+    free_list = (node_t*) heap;
+    free_list->size = UMEM_SIZE - sizeof(node_t);
+    free_list->next = NULL;
+    return heap;
+}
+
+void *umalloc(size_t size) {
+    if (heap == NULL && init_umem() == NULL)
+        return NULL;
+
+    if (size == 0)
+        return NULL;
+
+    size_t adjustedSize = (size + 7) & ~7; // Clear bottom bits to (000) to effectively convert to a base 8 after adding 7
+
+    node_t* curr = free_list;
+    node_t* prev = NULL;
+
+    // Walk the linked list
+    while (curr != NULL) {
+        // Size necessary is the size of requested portion
+        // Not using size of node_t or header_t bc they are same size
+        if (curr->size >= (long) adjustedSize) {
+            node_t* nextNode = curr->next;
+            size_t remaining = curr->size - adjustedSize ;
+
+            // Place header at start of the block
+            header_t* header = (header_t*) curr;
+            header->size = (long) adjustedSize;
+            header->magic = MAGIC;
+
+
+            // No point in splitting if there isn't enough space for at least 8 bytes after the next node
+            if (remaining >= sizeof(node_t) + 8) {
+                // Put at next slot (size of header + size in segment)
+                node_t* newNode = (node_t*) ((char*) header + sizeof(header_t) + adjustedSize);
+                newNode->size = remaining - sizeof(node_t); // reserve node size
+
+                // insert into list
+                newNode->next = nextNode;
+                if (prev != NULL) {
+                    prev->next = newNode;
+                } else {
+                    free_list = newNode;
+                }
+            } else {
+                if (prev != NULL) {
+                    prev->next = nextNode;
+                } else {
+                    free_list = nextNode;
+                }
+            }
+
+            return (void*) ((char*) header + sizeof(header_t));
+        }
+
+        prev = curr;
+        curr = curr->next;
+    }
+
+    return NULL;
+}
+
+void ufree(void *ptr) {
+    if (ptr == NULL) return;
+
+    header_t* header =  (header_t*) ((char*) ptr - sizeof(header_t));
+
+    if (header->magic != MAGIC) {
+        fprintf(stderr, "Error: Invalid magic number.\n");
+        return;
+    }
+
+
+    //convert to freed block
+    node_t* freed = (node_t*) header;
+    // safe to assume size should be the same bc size of header and node are both 16 bytes
+    freed->size = header->size;
+
+    // push to top of list
+    freed->next = free_list;
+    free_list = freed;
+}
+
+void umem_thread_start(int tid, int num_threads) {
+    (void)tid;
+    (void)num_threads;
+}
+
+void umem_block_start(void) {}
+
+void umem_thread_finish(void) {}
+
+void umem_threads_done(void) {}
+
+// The heap and free list pointers are the parent's, the child starts its own heap on its first umalloc
+void umem_fork_child(void) {
+    heap = NULL;
+    free_list = NULL;
+}
+
+void umem_report(void) {}
@@ -0,0 +1,474 @@
+/* `````````````````````````````````````````````````````````````````````
+ * Thread Pool Backend
+ *
+ * The first megabyte of the heap is cut into a bump pool per thread.
+ * umalloc takes from the calling thread's pool without any locking, and
+ * ufree of pool memory does nothing at all: the executor says when a
+ * block is done (umem_block_start) and the whole pool is emptied at
+ * once. What doesn't fit in a pool goes to the shared first-fit list
+ * in the second megabyte, with remote frees as in umem_shared.c.
+ *
+ * umemalign hands out cache-line aligned memory for the pool executor's
+ * workers. Building with DEBUG counts how many calls each path took.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ulock.h"
+#include "umem.h"
+#include "utrace.h"
+
+#define UMEM_SIZE (2 * 1024 * 1024)   // 2 MB: large enough for ~1000 concurrent blocks
+
+#define MAGIC 0xDEADBEEFLL
+
+typedef struct {
+    long size;
+    long magic;
+} header_t;
+
+typedef struct __node_t {
+    long size;
+    struct __node_t *next;
+} node_t;
+
+
+// Declaration of free list
+static node_t* free_list = NULL;
+
+#define ALIGNMENT 16
+#define ALIGN(size) (((size) + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1))
+
+// Declaration of locks, thread variables, and constants for pool size
+static ulock_t mLock = ULOCK_INITIALIZER;
+int use_multiprocess = 0;
+const char umem_name[] = "pools";
+
+#define MAX_POOL_SIZE 1024
+#define CACHE_LINE 64
+
+// Everything a thread writes on every allocation: its pool and, in the debug build, its lock counters. Every thread
+// has its own thread-local copy starting on its own cache line, so no two threads ever write to the same line.
+// Threads add their counters to finished when they're done.
+typedef struct {
+    _Alignas(CACHE_LINE) char* pool_start;
+    char* pool_current;
+    size_t pool_size;
+#ifdef DEBUG
+    // These are used for me to debug how many lock aquisitions are actually getting bypassed
+    int bypassAccesses;
+    int freeLockAccess;
+    int mallLockAccess;
+    int remoteFrees;
+#endif
+} thread_state_t;
+
+static __thread thread_state_t state;
+
+// thread heap where mostly unmanaged sections of memory live for each thread to do as they wish using pooling
+static char* thread_heap;
+
+#ifdef DEBUG
+// Counters of the threads that have finished
+static thread_state_t finished;
+static pthread_mutex_t finished_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+// The pools come first, the free list gets the rest
+void *init_umem(void) {
+    void *base = malloc(UMEM_SIZE);
+    if (!base) {
+        perror("malloc");
+        exit(1);
+    }
+
+    // I need to reserve 1mb for thread pools and I'm not sure how else I can do this other than pre-allocating before
+    // I make the free list. I think some threads will go over their fill and I need some left over to make sure it's
+    size_t total_reserved = UMEM_MAX_THREADS * MAX_POOL_SIZE;
+    size_t remaining = UMEM_SIZE - total_reserved;
+    free_list = (node_t *)((char*)base + total_reserved);
+    free_list->size = remaining - sizeof(node_t);
+    free_list->next = NULL;
+
+    thread_heap = base;
+
+    utrace_init();
+    return base;
+}
+
+// Merges neighbouring free chunks, the list is in address order so they are next to each other on it
+static void coalesce(void) {
+    node_t *curr = free_list;
+    while (curr && curr->next) {
+        char *end = (char *)curr + sizeof(node_t) + ALIGN(curr->size);
+        if (end == (char *)curr->next) {
+            curr->size += sizeof(node_t) + ALIGN(curr->next->size);
+            curr->next = curr->next->next;
+        } else {
+            curr = curr->next;
+        }
+    }
+}
+
+
+// First fit, splitting off whatever the request doesn't need
+static void *_umalloc(size_t size) {
+    if (size == 0) return NULL;
+
+    size = ALIGN(size);
+    node_t *prev = NULL;
+    node_t *curr = free_list;
+
+    while (curr) {
+        if (curr->size >= (long)size) {
+            char *alloc_start = (char *)curr;
+            long remaining = curr->size - (long)size;
+            node_t *next_free = curr->next;
+
+            header_t *hdr = (header_t *)alloc_start;
+            hdr->size = size;
+            hdr->magic = MAGIC;
+            void *user_ptr = alloc_start + sizeof(header_t);
+
+            if (remaining > (long)sizeof(node_t)) {
+                node_t *new_free = (node_t *)(alloc_start + sizeof(header_t) + size);
+                new_free->size = remaining - sizeof(node_t);
+                new_free->next = next_free;
+                if (prev)
+                    prev->next = new_free;
+                else
+                    free_list = new_free;
+            } else {
+                if (prev)
+                    prev->next = next_free;
+                else
+                    free_list = next_free;
+            }
+
+            return user_ptr;
+        }
+        prev = curr;
+        curr = curr->next;
+    }
+
+    return NULL;
+}
+
+// Puts a chunk back in address order and coalesces
+static void _ufree(void *ptr) {
+    if (!ptr) return;
+
+    header_t *hdr = (header_t *)((char *)ptr - sizeof(header_t));
+    if (hdr->magic != MAGIC) {
+        fprintf(stderr, "Error: invalid free detected.\n");
+        abort();
+    }
+
+    node_t *node = (node_t *)hdr;
+    node->size = ALIGN(hdr->size);
+    node->next = NULL;
+
+    if (!free_list || node < free_list) {
+        node->next = free_list;
+        free_list = node;
+    } else {
+        node_t *curr = free_list;
+        while (curr->next && curr->next < node)
+            curr = curr->next;
+        node->next = curr->next;
+        curr->next = node;
+    }
+
+    coalesce();
+}
+
+
+/* `````````````````````````````````````````````````````````````````````
+ * Remote Frees
+ *
+ * Buffers are often freed by a different thread than the one that
+ * allocated them (the main thread hands each worker its block). Instead
+ * of taking mLock, a free from another thread pushes the chunk onto the
+ * owner's remote-free list with a CAS. The owner swaps the whole list
+ * out on its next allocation and puts it back on the free list under a
+ * single lock acquisition with a single coalesce.
+ *
+ * The owner is recorded in the upper 32 bits of the header's magic, the
+ * lower 32 bits are still MAGIC. Owner 0 means nobody, which is what
+ * threads get once MAX_OWNERS ids have been handed out, and their chunks
+ * are always freed the old way.
+ */
+
+#define MAX_OWNERS 2048
+#define MAGIC_MASK 0xFFFFFFFFLL
+
+static _Atomic(node_t *) remote_free[MAX_OWNERS];
+static atomic_int next_owner = 1;
+static __thread int owner_id = -1;
+
+static int current_owner(void) {
+    if (owner_id < 0) {
+        int id = atomic_fetch_add(&next_owner, 1);
+        owner_id = id < MAX_OWNERS ? id : 0;
+    }
+    return owner_id;
+}
+
+// Inserts a chunk into the address-ordered free list without coalescing
+static void free_list_insert(node_t *node) {
+    if (!free_list || node < free_list) {
+        node->next = free_list;
+        free_list = node;
+    } else {
+        node_t *curr = free_list;
+        while (curr->next && curr->next < node)
+            curr = curr->next;
+        node->next = curr->next;
+        curr->next = node;
+    }
+}
+
+// Pushes a chunk onto its owner's remote-free list. The link goes where the magic was, like on the free list, so a
+// second free of the same chunk still fails the magic check.
+static void remote_push(int owner, header_t *hdr) {
+    node_t *node = (node_t *)hdr;
+    node_t *head = atomic_load_explicit(&remote_free[owner], memory_order_relaxed);
+    do {
+        node->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&remote_free[owner], &head, node, memory_order_release, memory_order_relaxed));
+}
+
+// Moves everything other threads freed for owner back onto the free list. Returns how many chunks that was.
+static int remote_drain(int owner) {
+    if (!atomic_load_explicit(&remote_free[owner], memory_order_relaxed))
+        return 0;
+    node_t *list = atomic_exchange_explicit(&remote_free[owner], NULL, memory_order_acquire);
+
+    int count = 0;
+    if (use_multiprocess)
+        ulock_lock(&mLock);
+    while (list) {
+        node_t *next = list->next;
+        free_list_insert(list);
+        list = next;
+        count++;
+    }
+    coalesce();
+    if (use_multiprocess)
+        ulock_unlock(&mLock);
+    return count;
+}
+
+// Drains every owner's list, for when threads have exited or an allocation is about to fail
+static int remote_drain_all(void) {
+    int count = 0;
+    int owners = atomic_load(&next_owner);
+    for (int i = 1; i < owners && i < MAX_OWNERS; i++)
+        count += remote_drain(i);
+    return count;
+}
+
+// Tags a fresh chunk with the allocating thread
+static void *set_owner(void *ptr) {
+    if (ptr) {
+        header_t *hdr = (header_t *)((char *)ptr - sizeof(header_t));
+        hdr->magic = MAGIC | (long)current_owner() << 32;
+    }
+    return ptr;
+}
+
+// Checks the chunk's magic and returns the thread that allocated it
+static int chunk_owner(header_t *hdr) {
+    if ((hdr->magic & MAGIC_MASK) != MAGIC) {
+        fprintf(stderr, "Error: invalid free detected.\n");
+        abort();
+    }
+    return (int)(hdr->magic >> 32);
+}
+
+// Bumps the calling thread's pool, and goes to the free list once it's full or when the thread has none
+static void* umalloc_fast(size_t size) {
+    size = ALIGN(size);
+    thread_state_t *s = &state;
+    if (s->pool_current != NULL) {
+        if (s->pool_current + size <= s->pool_start + s->pool_size) {
+            void* ptr = s->pool_current;
+            s->pool_current += size;
+			#ifdef DEBUG
+			s->bypassAccesses++;
+			#endif
+			return ptr;
+        }
+    }
+
+    // Take back whatever other threads freed for us before going to the free list
+    int owner = current_owner();
+    if (owner)
+        remote_drain(owner);
+
+    ulock_lock(&mLock);
+	#ifdef DEBUG
+	s->mallLockAccess++;
+    #endif
+	void* ptr = _umalloc(size);
+    ulock_unlock(&mLock);
+
+    // Out of room, but there may be chunks waiting on other threads' remote lists
+    if (!ptr && remote_drain_all())
+        return umalloc_fast(size);
+    return set_owner(ptr);
+}
+
+// umalloc_fast plus tracing
+void *umalloc(size_t size) {
+    void *p = umalloc_fast(size);
+    UTRACE_ALLOC_CALL(p, size);
+    return p;
+}
+
+// Marks a forwarding header in front of memory from umemalign, its size is how far back the real chunk starts
+#define ALIGNED_MAGIC 0xA11C0DEDLL
+
+// umalloc for memory starting on a multiple of alignment (a power of two), so hot structures can have cache lines to
+// themselves. Pools just skip ahead to the boundary. Anything else over-allocates and leaves a forwarding header
+// right before the aligned pointer for ufree to follow back to the real chunk.
+static void *_umemalign(size_t alignment, size_t size) {
+    if (alignment <= ALIGNMENT)
+        return umalloc_fast(size);
+
+    thread_state_t *s = &state;
+    if (s->pool_current != NULL) {
+        char *aligned = (char *)(((uintptr_t)s->pool_current + alignment - 1) & ~(uintptr_t)(alignment - 1));
+        if (aligned + ALIGN(size) <= s->pool_start + s->pool_size) {
+            s->pool_current = aligned + ALIGN(size);
+			#ifdef DEBUG
+			s->bypassAccesses++;
+			#endif
+            return aligned;
+        }
+    }
+
+    char *raw = umalloc_fast(size + alignment + sizeof(header_t));
+    if (!raw)
+        return NULL;
+    char *aligned = (char *)(((uintptr_t)raw + sizeof(header_t) + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    header_t *fwd = (header_t *)aligned - 1;
+    fwd->size = aligned - raw;
+    fwd->magic = ALIGNED_MAGIC;
+    return aligned;
+}
+
+// Traced as a plain umalloc of size, the alignment only matters to this allocator
+void *umemalign(size_t alignment, size_t size) {
+    void *p = _umemalign(alignment, size);
+    UTRACE_ALLOC_CALL(p, size);
+    return p;
+}
+
+// Pool memory goes back a whole pool at a time in umem_block_start, so freeing anything in the thread heap does
+// nothing. Everything else goes back to the free list.
+void ufree(void *ptr) {
+    if (ptr == NULL)
+        return;
+    UTRACE_FREE_CALL(ptr);
+
+    // No-op on thread heaps
+    if (thread_heap != NULL) {
+        char *c = (char *)ptr;
+        if (c >= thread_heap && c < thread_heap + UMEM_MAX_THREADS * MAX_POOL_SIZE) {
+			#ifdef DEBUG
+			state.bypassAccesses++;
+			#endif
+            return;
+        }
+    }
+
+    header_t *hdr = (header_t *)((char *)ptr - sizeof(header_t));
+    if (hdr->magic == ALIGNED_MAGIC) {
+        ptr = (char *)ptr - hdr->size;
+        hdr = (header_t *)((char *)ptr - sizeof(header_t));
+    }
+
+    // Chunks from another thread go back to that thread without touching mLock
+    int owner = chunk_owner(hdr);
+    if (owner && owner != current_owner()) {
+        #ifdef DEBUG
+        state.remoteFrees++;
+        #endif
+        remote_push(owner, hdr);
+        return;
+    }
+    hdr->magic = MAGIC;
+
+    if (use_multiprocess) {
+        ulock_lock(&mLock);
+	}
+
+	#ifdef DEBUG
+	state.freeLockAccess++;
+	#endif
+	
+	_ufree(ptr);
+
+	if (use_multiprocess) {
+        ulock_unlock(&mLock);
+	}
+}
+
+// Gives the thread its pool, thread tid of num_threads gets the tid'th share of the thread heap
+void umem_thread_start(int tid, int num_threads) {
+    thread_state_t *s = &state;
+    s->pool_size = MAX_POOL_SIZE * UMEM_MAX_THREADS / num_threads;
+    #ifdef DEBUG
+    printf("Pool size: %lu\n", s->pool_size);
+    #endif
+    size_t offset = tid * s->pool_size;
+    s->pool_start = (char*) thread_heap + offset;
+    s->pool_current = s->pool_start;
+}
+
+// Empties the calling thread's pool, everything in it must be dead
+void umem_block_start(void) {
+    state.pool_current = state.pool_start;
+    UTRACE_RESET_CALL();
+}
+
+#ifdef DEBUG
+static void add_counters(thread_state_t *total, const thread_state_t *s) {
+    total->bypassAccesses += s->bypassAccesses;
+    total->freeLockAccess += s->freeLockAccess;
+    total->mallLockAccess += s->mallLockAccess;
+    total->remoteFrees += s->remoteFrees;
+}
+#endif
+
+void umem_thread_finish(void) {
+#ifdef DEBUG
+    pthread_mutex_lock(&finished_lock);
+    add_counters(&finished, &state);
+    pthread_mutex_unlock(&finished_lock);
+#endif
+}
+
+void umem_threads_done(void) {
+    remote_drain_all();
+}
+
+void umem_fork_child(void) {}
+
+void umem_report(void) {
+#ifdef ULOCK_STATS
+    ulock_report("mLock", &mLock);
+#endif
+#ifdef DEBUG
+    // Everybody else's counters were added up as they finished, the calling thread's are still its own
+    thread_state_t total = finished;
+    add_counters(&total, &state);
+	printf("Malloc lock accesses: %d\nFree lock accesses: %d\nTotal bypassed: %d\nPercent bypassed: %0.2f", total.mallLockAccess, total.freeLockAccess, total.bypassAccesses, (float) (total.bypassAccesses / (float) (total.bypassAccesses + total.mallLockAccess + total.freeLockAccess)));
+	printf("\nRemote frees: %d\n", total.remoteFrees);
+#endif
+}
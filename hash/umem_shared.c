@@ -0,0 +1,305 @@
+/* `````````````````````````````````````````````````````````````````````
+ * Shared First-Fit Backend
+ *
+ * One address-ordered, coalescing first-fit list over a 2 MB heap, with
+ * mLock around it whenever blocks are hashed in parallel. Chunks freed by
+ * a thread other than the one that allocated them skip the lock and go
+ * back to their owner through a remote-free list (see Remote Frees).
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ulock.h"
+#include "umem.h"
+#include "utrace.h"
+
+#define UMEM_SIZE (2 * 1024 * 1024)   // 2 MB: large enough for ~1000 concurrent blocks
+
+#define MAGIC 0xDEADBEEFLL
+
+typedef struct {
+    long size;
+    long magic;
+} header_t;
+
+typedef struct __node_t {
+    long size;
+    struct __node_t *next;
+} node_t;
+
+static node_t* free_list = NULL;
+
+#define ALIGNMENT 16
+#define ALIGN(size) (((size) + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1))
+
+// mLock protects the free list, but only when use_multiprocess says somebody else might be using it
+static ulock_t mLock = ULOCK_INITIALIZER;
+int use_multiprocess = 0;
+const char umem_name[] = "shared";
+
+// The whole heap starts as one free chunk
+void *init_umem(void) {
+    void *base = malloc(UMEM_SIZE);
+    if (!base) {
+        perror("malloc");
+        exit(1);
+    }
+    free_list = (node_t *)base;
+    free_list->size = UMEM_SIZE - sizeof(node_t);
+    free_list->next = NULL;
+    utrace_init();
+    return base;
+}
+
+// Merges neighbouring free chunks, the list is in address order so they are next to each other on it
+static void coalesce(void) {
+    node_t *curr = free_list;
+    while (curr && curr->next) {
+        char *end = (char *)curr + sizeof(node_t) + ALIGN(curr->size);
+        if (end == (char *)curr->next) {
+            curr->size += sizeof(node_t) + ALIGN(curr->next->size);
+            curr->next = curr->next->next;
+        } else {
+            curr = curr->next;
+        }
+    }
+}
+
+// First fit, splitting off whatever the request doesn't need
+static void *_umalloc(size_t size) {
+    if (size == 0) return NULL;
+
+    size = ALIGN(size);
+    node_t *prev = NULL;
+    node_t *curr = free_list;
+
+    while (curr) {
+        if (curr->size >= (long)size) {
+            char *alloc_start = (char *)curr;
+            long remaining = curr->size - (long)size;
+            node_t *next_free = curr->next;
+
+            header_t *hdr = (header_t *)alloc_start;
+            hdr->size = size;
+            hdr->magic = MAGIC;
+            void *user_ptr = alloc_start + sizeof(header_t);
+
+            if (remaining > (long)sizeof(node_t)) {
+                node_t *new_free = (node_t *)(alloc_start + sizeof(header_t) + size);
+                new_free->size = remaining - sizeof(node_t);
+                new_free->next = next_free;
+                if (prev)
+                    prev->next = new_free;
+                else
+                    free_list = new_free;
+            } else {
+                if (prev)
+                    prev->next = next_free;
+                else
+                    free_list = next_free;
+            }
+
+            return user_ptr;
+        }
+        prev = curr;
+        curr = curr->next;
+    }
+
+    return NULL;
+}
+
+// Puts a chunk back in address order and coalesces
+static void _ufree(void *ptr) {
+    if (!ptr) return;
+
+    header_t *hdr = (header_t *)((char *)ptr - sizeof(header_t));
+    if (hdr->magic != MAGIC) {
+        fprintf(stderr, "Error: invalid free detected.\n");
+        abort();
+    }
+
+    node_t *node = (node_t *)hdr;
+    node->size = ALIGN(hdr->size);
+    node->next = NULL;
+
+    if (!free_list || node < free_list) {
+        node->next = free_list;
+        free_list = node;
+    } else {
+        node_t *curr = free_list;
+        while (curr->next && curr->next < node)
+            curr = curr->next;
+        node->next = curr->next;
+        curr->next = node;
+    }
+
+    coalesce();
+}
+
+/* `````````````````````````````````````````````````````````````````````
+ * Remote Frees
+ *
+ * Buffers are often freed by a different thread than the one that
+ * allocated them (the main thread hands each worker its block). Instead
+ * of taking mLock, a free from another thread pushes the chunk onto the
+ * owner's remote-free list with a CAS. The owner swaps the whole list
+ * out on its next allocation and puts it back on the free list under a
+ * single lock acquisition with a single coalesce.
+ *
+ * The owner is recorded in the upper 32 bits of the header's magic, the
+ * lower 32 bits are still MAGIC. Owner 0 means nobody, which is what
+ * threads get once MAX_OWNERS ids have been handed out, and their chunks
+ * are always freed the old way.
+ */
+
+#define MAX_OWNERS 2048
+#define MAGIC_MASK 0xFFFFFFFFLL
+
+static _Atomic(node_t *) remote_free[MAX_OWNERS];
+static atomic_int next_owner = 1;
+static __thread int owner_id = -1;
+
+static int current_owner(void) {
+    if (owner_id < 0) {
+        int id = atomic_fetch_add(&next_owner, 1);
+        owner_id = id < MAX_OWNERS ? id : 0;
+    }
+    return owner_id;
+}
+
+// Inserts a chunk into the address-ordered free list without coalescing
+static void free_list_insert(node_t *node) {
+    if (!free_list || node < free_list) {
+        node->next = free_list;
+        free_list = node;
+    } else {
+        node_t *curr = free_list;
+        while (curr->next && curr->next < node)
+            curr = curr->next;
+        node->next = curr->next;
+        curr->next = node;
+    }
+}
+
+// Pushes a chunk onto its owner's remote-free list. The link goes where the magic was, like on the free list, so a
+// second free of the same chunk still fails the magic check.
+static void remote_push(int owner, header_t *hdr) {
+    node_t *node = (node_t *)hdr;
+    node_t *head = atomic_load_explicit(&remote_free[owner], memory_order_relaxed);
+    do {
+        node->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&remote_free[owner], &head, node, memory_order_release, memory_order_relaxed));
+}
+
+// Moves everything other threads freed for owner back onto the free list. Returns how many chunks that was.
+static int remote_drain(int owner) {
+    if (!atomic_load_explicit(&remote_free[owner], memory_order_relaxed))
+        return 0;
+    node_t *list = atomic_exchange_explicit(&remote_free[owner], NULL, memory_order_acquire);
+
+    int count = 0;
+    if (use_multiprocess)
+        ulock_lock(&mLock);
+    while (list) {
+        node_t *next = list->next;
+        free_list_insert(list);
+        list = next;
+        count++;
+    }
+    coalesce();
+    if (use_multiprocess)
+        ulock_unlock(&mLock);
+    return count;
+}
+
+// Drains every owner's list, for when threads have exited or an allocation is about to fail
+static int remote_drain_all(void) {
+    int count = 0;
+    int owners = atomic_load(&next_owner);
+    for (int i = 1; i < owners && i < MAX_OWNERS; i++)
+        count += remote_drain(i);
+    return count;
+}
+
+// Tags a fresh chunk with the allocating thread
+static void *set_owner(void *ptr) {
+    if (ptr) {
+        header_t *hdr = (header_t *)((char *)ptr - sizeof(header_t));
+        hdr->magic = MAGIC | (long)current_owner() << 32;
+    }
+    return ptr;
+}
+
+// Checks the chunk's magic and returns the thread that allocated it
+static int chunk_owner(header_t *hdr) {
+    if ((hdr->magic & MAGIC_MASK) != MAGIC) {
+        fprintf(stderr, "Error: invalid free detected.\n");
+        abort();
+    }
+    return (int)(hdr->magic >> 32);
+}
+
+// Takes back whatever other threads freed for us first, and if the free list can't fit the request, whatever they
+// freed for anybody
+void *umalloc(size_t size) {
+    int owner = current_owner();
+    if (owner)
+        remote_drain(owner);
+
+    if (use_multiprocess)
+        ulock_lock(&mLock);
+    void* p = _umalloc(size);
+    if (use_multiprocess)
+        ulock_unlock(&mLock);
+
+    if (!p && remote_drain_all())
+        return umalloc(size);
+    p = set_owner(p);
+    UTRACE_ALLOC_CALL(p, size);
+    return p;
+}
+
+// Chunks from another thread go back to that thread without touching mLock
+void ufree(void *ptr) {
+    if (!ptr) return;
+    UTRACE_FREE_CALL(ptr);
+
+    header_t *hdr = (header_t *)((char *)ptr - sizeof(header_t));
+    int owner = chunk_owner(hdr);
+    if (owner && owner != current_owner()) {
+        remote_push(owner, hdr);
+        return;
+    }
+
+    hdr->magic = MAGIC;
+    if (use_multiprocess)
+        ulock_lock(&mLock);
+    _ufree(ptr);
+    if (use_multiprocess)
+        ulock_unlock(&mLock);
+}
+
+
+void umem_thread_start(int tid, int num_threads) {
+    (void)tid;
+    (void)num_threads;
+}
+
+void umem_block_start(void) {}
+
+void umem_thread_finish(void) {}
+
+void umem_threads_done(void) {
+    remote_drain_all();
+}
+
+void umem_fork_child(void) {}
+
+void umem_report(void) {
+#ifdef ULOCK_STATS
+    ulock_report("mLock", &mLock);
+#endif
+}
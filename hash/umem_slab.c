@@ -0,0 +1,501 @@
+/* `````````````````````````````````````````````````````````````````````
+ * Slab Backend
+ *
+ * The objects the engine allocates (huffman.h) come from headerless
+ * slabs of their exact sizes in the first three quarters of a 2 MB heap.
+ * Everything else goes to first-fit lists in the last quarter, one per
+ * power-of-two size class, each under its own lock.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "huffman.h"
+#include "ulock.h"
+#include "umem.h"
+#include "utrace.h"
+
+#define UMEM_SIZE (2 * 1024 * 1024)   // 2 MB: large enough for ~1000 concurrent blocks
+
+#define MAGIC 0xDEADBEEFLL
+
+typedef struct {
+    long size;
+    long magic;
+} header_t;
+
+typedef struct __node_t {
+    long size;
+    struct __node_t *next;
+} node_t;
+
+// Every class has its own free list and lock
+#define NUM_CLASSES 8
+static ulock_t locks[NUM_CLASSES];
+static node_t* free_lists[NUM_CLASSES];
+
+#define ALIGNMENT 16
+#define ALIGN(size) (((size) + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1))
+
+// The slab and first-fit locks are always taken, they are cheap when nobody else wants them
+int use_multiprocess = 0;
+const char umem_name[] = "slab";
+
+static int get_class(size_t size) {
+    if (size == 0) return 0;
+    int c = 0;
+    size_t threshold = 32;
+    while (size > threshold && c < NUM_CLASSES - 1) {
+        threshold *= 2;
+        c++;
+    }
+    return c;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * Headerless Slabs Sized for the Huffman Objects
+ *
+ * A 16-byte header on a 32-byte Node makes every tree half again as big
+ * as it needs to be. The few things this program allocates (listed in
+ * HUFFMAN_OBJECTS) are instead served from page-sized slabs that each
+ * hold objects of one of those exact sizes. The object's size comes from
+ * the page map: its address gives its page, and the page's descriptor
+ * knows which class it was carved for, so the object itself carries
+ * nothing but the caller's data.
+ *
+ * Every class takes its pages from the same pool and gives them back
+ * once they're empty, so a class only holds what it is using right now.
+ * The threads executor can fill most of the region with block buffers
+ * and the pages go to tree nodes as the buffers are freed, where fixed
+ * sections would leave one class failing while the others sat empty.
+ *
+ * Sizes that aren't close to a class (the first-fit lists would waste
+ * less on them) go to the first-fit lists, with headers, in the last
+ * quarter of the heap.
+ *
+ * Without a header there is no magic to check on free. Building with
+ * UMEM_CHECKED puts MAGIC in the second word of every free slab object
+ * and rejects frees of objects that already have it, plus pointers that
+ * aren't the start of an object on a live slab.
+ */
+
+#define SLAB_PAGE 4096
+#define SLAB_MAX (SLAB_PAGE / 2)            // a slab holds at least two objects
+#define SLAB_REGION (UMEM_SIZE / 4 * 3)
+#define SLAB_PAGES (SLAB_REGION / SLAB_PAGE)
+
+// Each entry becomes a slab class of exactly that size
+#define HUFFMAN_OBJECTS(X) \
+    X(NODE, sizeof(Node)) \
+    X(MIN_HEAP, sizeof(MinHeap)) \
+    X(HEAP_ARRAY, sizeof(Node *) * SYMBOLS) \
+    X(BLOCK_BUFFER, BLOCK_SIZE) \
+    X(THREAD_ARG, sizeof(thread_arg_t))
+
+#define SLAB_CLASS_ID(name, size) SLAB_##name,
+enum { HUFFMAN_OBJECTS(SLAB_CLASS_ID) SLAB_CLASSES };
+#undef SLAB_CLASS_ID
+
+#define SLAB_CLASS_SIZE(name, size) ALIGN(size),
+static const size_t slab_sizes[SLAB_CLASSES] = { HUFFMAN_OBJECTS(SLAB_CLASS_SIZE) };
+#undef SLAB_CLASS_SIZE
+
+#define SLAB_CLASS_CHECK(name, size) _Static_assert(ALIGN(size) <= SLAB_MAX, #name " is too big for a slab");
+HUFFMAN_OBJECTS(SLAB_CLASS_CHECK)
+#undef SLAB_CLASS_CHECK
+
+// Page map entry, one per slab page
+typedef struct {
+    void *free;        // free objects on this page, linked through their first word
+    int slab_class;    // -1 while the page is unused
+    int used;          // objects handed out
+    int prev, next;    // neighbours on the class's partial list, or next unused page
+} slab_t;
+
+static char *slab_base;
+static slab_t page_map[SLAB_PAGES];
+static int partial_slabs[SLAB_CLASSES];   // first page with free objects, per class
+static ulock_t slab_locks[SLAB_CLASSES];
+static int free_pages = -1;
+static ulock_t page_lock = ULOCK_INITIALIZER;
+
+// Slab class for each size in ALIGNMENT steps up to SLAB_MAX, -1 for sizes that go to the first-fit lists
+static signed char size_classes[SLAB_MAX / ALIGNMENT + 1];
+
+// Smallest class that fits each size, as long as that wastes less than the object itself
+static void size_classes_init(void) {
+    for (size_t i = 0; i <= SLAB_MAX / ALIGNMENT; i++) {
+        size_t size = i * ALIGNMENT;
+        size_classes[i] = -1;
+        for (int c = 0; c < SLAB_CLASSES; c++) {
+            if (slab_sizes[c] >= size && slab_sizes[c] < 2 * size &&
+                (size_classes[i] < 0 || slab_sizes[c] < slab_sizes[(int)size_classes[i]]))
+                size_classes[i] = (signed char)c;
+        }
+    }
+}
+
+static int slab_class(size_t size) {
+    return size_classes[ALIGN(size) / ALIGNMENT];
+}
+
+static size_t slab_size(int c) {
+    return slab_sizes[c];
+}
+
+static void partial_remove(int c, int page) {
+    slab_t *s = &page_map[page];
+    if (s->prev >= 0)
+        page_map[s->prev].next = s->next;
+    else
+        partial_slabs[c] = s->next;
+    if (s->next >= 0)
+        page_map[s->next].prev = s->prev;
+}
+
+static void partial_push(int c, int page) {
+    slab_t *s = &page_map[page];
+    s->prev = -1;
+    s->next = partial_slabs[c];
+    if (s->next >= 0)
+        page_map[s->next].prev = page;
+    partial_slabs[c] = page;
+}
+
+// Takes an unused page and carves it into objects of class c. Returns -1 when the slab region is full.
+static int slab_new(int c) {
+    ulock_lock(&page_lock);
+    int page = free_pages;
+    if (page >= 0)
+        free_pages = page_map[page].next;
+    ulock_unlock(&page_lock);
+    if (page < 0)
+        return -1;
+
+    size_t size = slab_size(c);
+    char *start = slab_base + (size_t)page * SLAB_PAGE;
+    slab_t *s = &page_map[page];
+    s->free = NULL;
+    // Build the list back to front so objects are handed out in address order
+    for (size_t off = (SLAB_PAGE / size - 1) * size;; off -= size) {
+        void **obj = (void **)(start + off);
+        obj[0] = s->free;
+#ifdef UMEM_CHECKED
+        obj[1] = (void *)MAGIC;
+#endif
+        s->free = obj;
+        if (off == 0)
+            break;
+    }
+    s->slab_class = c;
+    s->used = 0;
+    partial_push(c, page);
+    return page;
+}
+
+static void *slab_alloc(size_t size) {
+    int c = slab_class(size);
+    if (c < 0)
+        return NULL;
+    ulock_lock(&slab_locks[c]);
+
+    int page = partial_slabs[c];
+    if (page < 0 && (page = slab_new(c)) < 0) {
+        ulock_unlock(&slab_locks[c]);
+        return NULL;
+    }
+
+    slab_t *s = &page_map[page];
+    void **obj = s->free;
+    s->free = obj[0];
+#ifdef UMEM_CHECKED
+    obj[1] = NULL;
+#endif
+    if (++s->used * slab_size(c) > SLAB_PAGE - slab_size(c))
+        partial_remove(c, page);   // that was its last object
+
+    ulock_unlock(&slab_locks[c]);
+    return obj;
+}
+
+static void slab_free(void *ptr) {
+    int page = (int)(((char *)ptr - slab_base) / SLAB_PAGE);
+    slab_t *s = &page_map[page];
+    int c = s->slab_class;
+    void **obj = ptr;
+
+#ifdef UMEM_CHECKED
+    if (c < 0 || ((char *)ptr - slab_base) % SLAB_PAGE % slab_size(c) != 0 || obj[1] == (void *)MAGIC) {
+        fprintf(stderr, "Error: invalid free detected.\n");
+        abort();
+    }
+#endif
+
+    ulock_lock(&slab_locks[c]);
+    size_t per_page = SLAB_PAGE / slab_size(c);
+    if ((size_t)s->used == per_page)
+        partial_push(c, page);   // full slab has room again
+
+    obj[0] = s->free;
+#ifdef UMEM_CHECKED
+    obj[1] = (void *)MAGIC;
+#endif
+    s->free = obj;
+
+    // Give empty pages back for other classes to use, but keep one around so a class that's allocating and freeing
+    // a single object doesn't carve a fresh page every time
+    if (--s->used == 0 && (partial_slabs[c] != page || s->next >= 0)) {
+        partial_remove(c, page);
+        s->slab_class = -1;
+        ulock_lock(&page_lock);
+        s->next = free_pages;
+        free_pages = page;
+        ulock_unlock(&page_lock);
+    }
+    ulock_unlock(&slab_locks[c]);
+}
+
+static int in_slabs(const void *ptr) {
+    return (const char *)ptr >= slab_base && (const char *)ptr < slab_base + SLAB_REGION;
+}
+
+void *init_umem(void) {
+    // Page aligned so an object's page is just its offset divided by SLAB_PAGE
+    void *base = NULL;
+    if (posix_memalign(&base, SLAB_PAGE, UMEM_SIZE) != 0) {
+        perror("posix_memalign");
+        exit(1);
+    }
+
+    for (int i = 0; i < NUM_CLASSES; i++) {
+        ulock_init(&locks[i]);
+    }
+
+    slab_base = base;
+    for (int i = 0; i < SLAB_CLASSES; i++) {
+        ulock_init(&slab_locks[i]);
+        partial_slabs[i] = -1;
+    }
+    for (int i = SLAB_PAGES - 1; i >= 0; i--) {
+        page_map[i].slab_class = -1;
+        page_map[i].next = free_pages;
+        free_pages = i;
+    }
+
+    size_classes_init();
+
+    // Each class starts with an equal section of what's left, _umalloc borrows from the others when it runs out
+    size_t section_size = (UMEM_SIZE - SLAB_REGION) / NUM_CLASSES;
+    for (int i = 0; i < NUM_CLASSES; i++) {
+        char *section_start = (char *)base + SLAB_REGION + i * section_size;
+        free_lists[i] = (node_t *)section_start;
+        free_lists[i]->size = section_size - sizeof(node_t);
+        free_lists[i]->next = NULL;
+    }
+
+    utrace_init();
+    return base;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * Coalescing: Merge Adjacent Free Blocks
+ *
+ * After freeing, adjacent blocks in memory should be merged into larger
+ * blocks to reduce fragmentation. We maintain the free list in address
+ * order (see _ufree), so adjacency is detected by checking if one block's
+ * end address equals the next block's start address.
+ *
+ * Why this matters for correctness: Without coalescing, the free list
+ * could become fragmented into tiny unusable pieces. With concurrent
+ * access, corruption here (following a bad pointer) was our most subtle
+ * bug - if curr->next points to an allocated block, we read that block's
+ * header->magic thinking it's a next pointer, causing infinite loops.
+ */
+
+static void coalesce(int c) {
+    node_t *curr = free_lists[c];
+    while (curr && curr->next) {
+        char *end = (char *)curr + sizeof(node_t) + ALIGN(curr->size);
+        if (end == (char *)curr->next) {
+            curr->size += sizeof(node_t) + ALIGN(curr->next->size);
+            curr->next = curr->next->next;
+        } else {
+            curr = curr->next;
+        }
+    }
+}
+
+/* `````````````````````````````````````````````````````````````````````
+ * First-Fit Allocator
+ *
+ * Searches the free list for the first block large enough to satisfy
+ * the request. If the block is larger than needed, it's split: the
+ * allocated portion becomes unavailable, and the remainder stays on
+ * the free list.
+ *
+ * Why first-fit: Simple, fast for small allocations, and "good enough"
+ * for teaching. Best-fit would reduce fragmentation but requires scanning
+ * the entire list. Worst-fit is rarely useful.
+ *
+ * Critical detail: We save curr->next BEFORE overwriting the node with
+ * a header. When we allocate from the head of the free list and create
+ * a remainder, we need to know what used to be next.
+ *
+ * Lock contention source: Every allocation traverses this list under the
+ * global semaphore. With N concurrent processes all building Huffman trees
+ * (hundreds of allocations each), this becomes a severe bottleneck.
+ */
+
+// First fit from class c's list, NULL if nothing on it is big enough
+static void *take_from_class(int c, size_t size) {
+    ulock_lock(&locks[c]);
+
+    node_t *prev = NULL;
+    node_t *curr = free_lists[c];
+
+    while (curr) {
+        if (curr->size >= (long)size) {
+            char *alloc_start = (char *)curr;
+            long remaining = curr->size - (long)size;
+            node_t *next_free = curr->next;
+
+            header_t *hdr = (header_t *)alloc_start;
+            hdr->size = size;
+            hdr->magic = MAGIC;
+            void *user_ptr = alloc_start + sizeof(header_t);
+
+            if (remaining > (long)sizeof(node_t)) {
+                node_t *new_free = (node_t *)(alloc_start + sizeof(header_t) + size);
+                new_free->size = remaining - sizeof(node_t);
+                new_free->next = next_free;
+                if (prev)
+                    prev->next = new_free;
+                else
+                    free_lists[c] = new_free;
+            } else {
+                if (prev)
+                    prev->next = next_free;
+                else
+                    free_lists[c] = next_free;
+            }
+
+            ulock_unlock(&locks[c]);
+            return user_ptr;
+        }
+        prev = curr;
+        curr = curr->next;
+    }
+
+    ulock_unlock(&locks[c]);
+    return NULL;
+}
+
+// A class that has run out borrows from the others. The block goes back to the list of its own size when it's
+// freed, so memory drifts to whichever classes are in use.
+static void *_umalloc(size_t size) {
+    if (size == 0) return NULL;
+    size = ALIGN(size);
+
+    int c = get_class(size);
+    for (int i = 0; i < NUM_CLASSES; i++) {
+        void *p = take_from_class((c + i) % NUM_CLASSES, size);
+        if (p)
+            return p;
+    }
+    return NULL;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * Free: Return Block to Free List (in Address Order)
+ *
+ * Converts the allocated block back to a free node and inserts it into
+ * the free list in address order. Address ordering is essential for
+ * coalescing to work - we need adjacent blocks to be neighbors in the list.
+ *
+ * The magic number check catches double-frees and corruption. If someone
+ * calls ufree() on an already-freed pointer, magic will likely be wrong
+ * (it's been overwritten by node_t fields).
+ *
+ * After insertion, we coalesce to merge with adjacent blocks. This is
+ * another source of lock contention - every free does a full list walk.
+ */
+
+static void _ufree(void *ptr) {
+    if (!ptr) return;
+
+    header_t *hdr = (header_t *)((char *)ptr - sizeof(header_t));
+    if (hdr->magic != MAGIC) {
+        fprintf(stderr, "Error: invalid free detected.\n");
+        abort();
+    }
+
+    int class = get_class(hdr->size);  // Use original allocated size for class
+    ulock_lock(&locks[class]);
+
+    node_t *node = (node_t *)hdr;
+    node->size = ALIGN(hdr->size);
+    node->next = NULL;
+
+    // Insert in address order
+    if (!free_lists[class] || node < free_lists[class]) {
+        node->next = free_lists[class];
+        free_lists[class] = node;
+    } else {
+        node_t *curr = free_lists[class];
+        while (curr->next && curr->next < node)
+            curr = curr->next;
+        node->next = curr->next;
+        curr->next = node;
+    }
+
+    coalesce(class);
+    ulock_unlock(&locks[class]);
+}
+
+void *umalloc(size_t size) {
+    if (size == 0) return NULL;
+    void *p = size <= SLAB_MAX ? slab_alloc(size) : NULL;
+    // No class for this size, or out of slab pages
+    if (!p)
+        p = _umalloc(size);
+    UTRACE_ALLOC_CALL(p, size);
+    return p;
+}
+
+void ufree(void *ptr) {
+    if (!ptr) return;
+    UTRACE_FREE_CALL(ptr);
+    if (in_slabs(ptr))
+        slab_free(ptr);
+    else
+        _ufree(ptr);
+}
+
+void umem_thread_start(int tid, int num_threads) {
+    (void)tid;
+    (void)num_threads;
+}
+
+void umem_block_start(void) {}
+
+void umem_thread_finish(void) {}
+
+void umem_threads_done(void) {}
+
+void umem_fork_child(void) {}
+
+void umem_report(void) {
+#ifdef ULOCK_STATS
+    char name[32];
+    for (int c = 0; c < NUM_CLASSES; c++) {
+        snprintf(name, sizeof(name), "locks[%d]", c);
+        ulock_report(name, &locks[c]);
+    }
+    for (int c = 0; c < SLAB_CLASSES; c++) {
+        snprintf(name, sizeof(name), "slab_locks[%d]", c);
+        ulock_report(name, &slab_locks[c]);
+    }
+    ulock_report("page_lock", &page_lock);
+#endif
+}
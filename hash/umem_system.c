@@ -0,0 +1,46 @@
+/* `````````````````````````````````````````````````````````````````````
+ * System Backend
+ *
+ * umalloc and ufree are the C library's malloc and free, the baseline
+ * every other backend is measured against.
+ */
+
+#include <stdlib.h>
+
+#include "umem.h"
+#include "utrace.h"
+
+int use_multiprocess = 0;
+const char umem_name[] = "system";
+
+void *init_umem(void) {
+    utrace_init();
+    return NULL;
+}
+
+void *umalloc(size_t size) {
+    void *p = malloc(size);
+    UTRACE_ALLOC_CALL(p, size);
+    return p;
+}
+
+void ufree(void *ptr) {
+    if (!ptr) return;
+    UTRACE_FREE_CALL(ptr);
+    free(ptr);
+}
+
+void umem_thread_start(int tid, int num_threads) {
+    (void)tid;
+    (void)num_threads;
+}
+
+void umem_block_start(void) {}
+
+void umem_thread_finish(void) {}
+
+void umem_threads_done(void) {}
+
+void umem_fork_child(void) {}
+
+void umem_report(void) {}
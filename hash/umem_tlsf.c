@@ -0,0 +1,77 @@
+/* `````````````````````````````````````````````````````````````````````
+ * TLSF Backend
+ *
+ * umalloc and ufree go to a Two-Level Segregated Fit allocator (tlsf.c)
+ * over a 2 MB heap instead of umem_shared.c's first-fit list. Both are
+ * O(1), so the time spent holding mLock no longer grows with how many
+ * free chunks there are, which is what drives the first-fit version's
+ * worst-case block times. Frees still take mLock, a TLSF free is short
+ * enough that handing it to the owner isn't worth it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tlsf.h"
+#include "ulock.h"
+#include "umem.h"
+#include "utrace.h"
+
+#define UMEM_SIZE (2 * 1024 * 1024)   // 2 MB: large enough for ~1000 concurrent blocks
+
+// mLock protects the TLSF state, but only when use_multiprocess says somebody else might be using it
+static ulock_t mLock = ULOCK_INITIALIZER;
+int use_multiprocess = 0;
+const char umem_name[] = "tlsf";
+
+static tlsf_t umem_tlsf;
+
+void *init_umem(void) {
+    void *base = malloc(UMEM_SIZE);
+    if (!base) {
+        perror("malloc");
+        exit(1);
+    }
+    umem_tlsf = tlsf_create_with_pool(base, UMEM_SIZE);
+    utrace_init();
+    return base;
+}
+
+void *umalloc(size_t size) {
+    if (use_multiprocess)
+        ulock_lock(&mLock);
+    void *p = tlsf_malloc(umem_tlsf, size);
+    if (use_multiprocess)
+        ulock_unlock(&mLock);
+    UTRACE_ALLOC_CALL(p, size);
+    return p;
+}
+
+void ufree(void *ptr) {
+    if (!ptr) return;
+    UTRACE_FREE_CALL(ptr);
+    if (use_multiprocess)
+        ulock_lock(&mLock);
+    tlsf_free(umem_tlsf, ptr);
+    if (use_multiprocess)
+        ulock_unlock(&mLock);
+}
+
+void umem_thread_start(int tid, int num_threads) {
+    (void)tid;
+    (void)num_threads;
+}
+
+void umem_block_start(void) {}
+
+void umem_thread_finish(void) {}
+
+void umem_threads_done(void) {}
+
+void umem_fork_child(void) {}
+
+void umem_report(void) {
+#ifdef ULOCK_STATS
+    ulock_report("mLock", &mLock);
+#endif
+}
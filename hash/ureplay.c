@@ -0,0 +1,364 @@
+/* `````````````````````````````````````````````````````````````````````
+ * Allocation Trace Replay
+ *
+ * Plays a trace written with UMALLOC_TRACE (see utrace.h) against the
+ * allocator this executable was linked with (see ubackend.h), so pool
+ * sizes and size classes can be tried against the calls a real run made
+ * without hashing the file again.
+ *
+ * By default one thread makes every call in the order they happened.
+ * With -i each recorded thread gets a thread of its own, and the threads
+ * take turns so that calls still happen in the recorded order, frees of
+ * another thread's memory included.
+ *
+ * Addresses only mean something to the allocator that made the trace,
+ * so loading turns them into object ids: a umalloc starts a new object
+ * and a ufree ends the live object at that address. A umalloc that gets
+ * an address that is still live leaves the old object to leak. Pool
+ * resets are replayed as a umem_block_start on the replaying thread,
+ * which only backends with pools act on.
+ *
+ * Usage: ureplay [-i] [-s] <trace>
+ *   -i   replay with the recorded threads and their interleaving
+ *   -s   print what the trace asks for (size histogram, peak live bytes)
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "utrace.h"
+#include "ubackend.h"
+
+#define NO_OBJECT UINT32_MAX
+
+typedef struct {
+    uint32_t id;        // object the call makes or ends, NO_OBJECT for a ufree of an address that wasn't live
+    uint32_t size;
+    uint16_t thread;
+    uint8_t op;
+} event_t;
+
+typedef struct {
+    event_t *events;
+    long num_events;
+    long num_objects;
+    int num_threads;
+    long unmatched_frees;
+} trace_t;
+
+typedef struct {
+    int thread;
+    trace_t *trace;
+    long *mine;             // indexes of this thread's events, in order
+    long num_mine;
+} replayer_t;
+
+static _Atomic long turn;   // index of the next event to play in -i mode
+
+// Only one call plays at a time in either mode, so these need no locking
+static void **objects;
+static uint32_t *object_sizes;
+static long live, peak_live, failed;
+
+static long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static int compare_seq(const void *a, const void *b) {
+    uint64_t x = ((const utrace_record_t *)a)->seq, y = ((const utrace_record_t *)b)->seq;
+    return (x > y) - (x < y);
+}
+
+/* =======================================================================
+   Loading
+   ======================================================================= */
+
+// Open addressing from live addresses to object ids, deleted slots keep probing going
+typedef struct {
+    uint64_t addr;
+    uint32_t id;
+} slot_t;
+
+#define SLOT_EMPTY 0
+#define SLOT_DELETED 1      // no allocator hands out address 1
+
+static uint64_t hash_addr(uint64_t addr) {
+    return (addr >> 4) * 0x9E3779B97F4A7C15ULL;
+}
+
+static slot_t *find_slot(slot_t *table, uint64_t mask, uint64_t addr, int for_insert) {
+    slot_t *deleted = NULL;
+    for (uint64_t i = hash_addr(addr) & mask;; i = (i + 1) & mask) {
+        slot_t *s = &table[i];
+        if (s->addr == addr)
+            return s;
+        if (s->addr == SLOT_DELETED && !deleted)
+            deleted = s;
+        if (s->addr == SLOT_EMPTY)
+            return for_insert ? (deleted ? deleted : s) : NULL;
+    }
+}
+
+static utrace_record_t *read_records(const char *path, long *count) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+
+    utrace_header_t header;
+    if (fread(&header, sizeof(header), 1, f) != 1 || header.magic != UTRACE_MAGIC) {
+        fprintf(stderr, "%s is not an allocation trace\n", path);
+        fclose(f);
+        return NULL;
+    }
+    if (header.version != UTRACE_VERSION || header.record_size != sizeof(utrace_record_t)) {
+        fprintf(stderr, "%s is trace version %u, this is version %d\n", path, header.version, UTRACE_VERSION);
+        fclose(f);
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long n = (ftell(f) - (long)sizeof(header)) / (long)sizeof(utrace_record_t);
+    fseek(f, sizeof(header), SEEK_SET);
+
+    utrace_record_t *records = malloc(sizeof(utrace_record_t) * (n ? n : 1));
+    if (!records || (long)fread(records, sizeof(utrace_record_t), n, f) != n) {
+        fprintf(stderr, "Error reading %s\n", path);
+        free(records);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+
+    qsort(records, n, sizeof(utrace_record_t), compare_seq);
+    *count = n;
+    return records;
+}
+
+static int load_trace(const char *path, trace_t *trace, int print_stats) {
+    long n;
+    utrace_record_t *records = read_records(path, &n);
+    if (!records)
+        return 0;
+
+    uint64_t capacity = 16;
+    while (capacity < (uint64_t)n * 2)
+        capacity *= 2;
+    slot_t *table = calloc(capacity, sizeof(slot_t));
+    event_t *events = malloc(sizeof(event_t) * (n ? n : 1));
+    if (!table || !events) {
+        fprintf(stderr, "Out of memory loading %s\n", path);
+        exit(1);
+    }
+
+    memset(trace, 0, sizeof(*trace));
+    uint32_t *traced_sizes = print_stats ? malloc(sizeof(uint32_t) * (n ? n : 1)) : NULL;
+    long traced_live = 0, traced_peak = 0;
+
+    for (long i = 0; i < n; i++) {
+        utrace_record_t *r = &records[i];
+        event_t *e = &events[i];
+        e->size = r->size;
+        e->thread = r->thread;
+        e->op = r->op;
+        e->id = NO_OBJECT;
+        if (r->thread >= trace->num_threads)
+            trace->num_threads = r->thread + 1;
+
+        if (r->op == UTRACE_ALLOC) {
+            e->id = (uint32_t)trace->num_objects++;
+            if (r->addr > SLOT_DELETED) {
+                slot_t *s = find_slot(table, capacity - 1, r->addr, 1);
+                s->addr = r->addr;
+                s->id = e->id;
+            }
+            if (traced_sizes) {
+                traced_sizes[e->id] = r->size;
+                traced_live += r->size;
+                traced_peak = traced_live > traced_peak ? traced_live : traced_peak;
+            }
+        } else if (r->op == UTRACE_FREE) {
+            slot_t *s = find_slot(table, capacity - 1, r->addr, 0);
+            if (s) {
+                e->id = s->id;
+                s->addr = SLOT_DELETED;
+                if (traced_sizes)
+                    traced_live -= traced_sizes[e->id];
+            } else {
+                trace->unmatched_frees++;
+            }
+        }
+    }
+
+    trace->events = events;
+    trace->num_events = n;
+
+    if (print_stats) {
+        // Sizes by how often they're asked for, the first thing to look at when picking classes
+        enum { MAX_SIZE = 65536 };
+        long *counts = calloc(MAX_SIZE + 1, sizeof(long));
+        long allocs = 0;
+        for (long i = 0; i < n; i++) {
+            if (events[i].op == UTRACE_ALLOC) {
+                counts[events[i].size < MAX_SIZE ? events[i].size : MAX_SIZE]++;
+                allocs++;
+            }
+        }
+        printf("Trace: %ld calls (%ld umalloc) from %d threads over %.3f ms, peak live %ld bytes\n", n, allocs,
+               trace->num_threads, n ? records[n - 1].time_ns / 1e6 : 0.0, traced_peak);
+        printf("%10s %10s %7s\n", "size", "count", "share");
+        for (int shown = 0; shown < 20; shown++) {
+            long best = 0;
+            int best_size = -1;
+            for (int s = 0; s <= MAX_SIZE; s++) {
+                if (counts[s] > best) {
+                    best = counts[s];
+                    best_size = s;
+                }
+            }
+            if (best_size < 0)
+                break;
+            printf("%9d%s %10ld %6.2f%%\n", best_size, best_size == MAX_SIZE ? "+" : " ", best, 100.0 * best / allocs);
+            counts[best_size] = 0;
+        }
+        free(counts);
+        free(traced_sizes);
+    }
+
+    free(table);
+    free(records);
+    return 1;
+}
+
+/* =======================================================================
+   Replay
+   ======================================================================= */
+
+static void play(const event_t *e) {
+    switch (e->op) {
+        case UTRACE_ALLOC: {
+            void *p = bench_alloc(e->size);
+            objects[e->id] = p;
+            if (!p) {
+                failed++;
+                break;
+            }
+            memset(p, 0, e->size < 64 ? e->size : 64);
+            object_sizes[e->id] = e->size;
+            live += e->size;
+            if (live > peak_live)
+                peak_live = live;
+            break;
+        }
+        case UTRACE_FREE:
+            if (e->id != NO_OBJECT && objects[e->id]) {
+                live -= object_sizes[e->id];
+                bench_free(objects[e->id]);
+                objects[e->id] = NULL;
+            }
+            break;
+        case UTRACE_RESET:
+            bench_pool_reset();
+            break;
+        default:
+            break;
+    }
+}
+
+static void *replay_thread(void *arg) {
+    replayer_t *r = arg;
+    bench_thread_init(r->thread, r->trace->num_threads);
+    for (long k = 0; k < r->num_mine; k++) {
+        long i = r->mine[k];
+        while (atomic_load_explicit(&turn, memory_order_acquire) != i)
+            sched_yield();
+        play(&r->trace->events[i]);
+        atomic_store_explicit(&turn, i + 1, memory_order_release);
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    int interleave = 0, print_stats = 0;
+    const char *path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-i")) {
+            interleave = 1;
+        } else if (!strcmp(argv[i], "-s")) {
+            print_stats = 1;
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "Usage: %s [-i] [-s] <trace>\n", argv[0]);
+        return 1;
+    }
+
+    trace_t trace;
+    if (!load_trace(path, &trace, print_stats))
+        return 1;
+
+    bench_init();
+
+    objects = calloc(trace.num_objects ? trace.num_objects : 1, sizeof(void *));
+    object_sizes = calloc(trace.num_objects ? trace.num_objects : 1, sizeof(uint32_t));
+    int num_threads = interleave && trace.num_threads > 1 ? trace.num_threads : 1;
+
+    long start = now_ns();
+    if (num_threads == 1) {
+        bench_thread_init(0, 1);
+        for (long i = 0; i < trace.num_events; i++)
+            play(&trace.events[i]);
+    } else {
+        replayer_t *replayers = calloc(num_threads, sizeof(replayer_t));
+        for (int t = 0; t < num_threads; t++) {
+            replayers[t].thread = t;
+            replayers[t].trace = &trace;
+            replayers[t].mine = malloc(sizeof(long) * (trace.num_events ? trace.num_events : 1));
+        }
+        for (long i = 0; i < trace.num_events; i++) {
+            replayer_t *r = &replayers[trace.events[i].thread];
+            r->mine[r->num_mine++] = i;
+        }
+
+        pthread_t *tids = malloc(sizeof(pthread_t) * num_threads);
+        start = now_ns();
+        for (int t = 0; t < num_threads; t++) {
+            if (pthread_create(&tids[t], NULL, replay_thread, &replayers[t])) {
+                perror("pthread_create");
+                exit(1);
+            }
+        }
+        for (int t = 0; t < num_threads; t++)
+            pthread_join(tids[t], NULL);
+
+        for (int t = 0; t < num_threads; t++)
+            free(replayers[t].mine);
+        free(replayers);
+        free(tids);
+    }
+    double seconds = (now_ns() - start) / 1e9;
+
+    printf("Replayed %ld calls on %d thread%s in %.3f ms (%.0f calls/sec)\n", trace.num_events, num_threads,
+           num_threads == 1 ? "" : "s", seconds * 1e3, trace.num_events / seconds);
+    printf("Peak live: %ld bytes  Failed umallocs: %ld  Unmatched ufrees: %ld\n", peak_live, failed,
+           trace.unmatched_frees);
+
+    free(object_sizes);
+    free(objects);
+    free(trace.events);
+    return 0;
+}
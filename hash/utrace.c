@@ -0,0 +1,135 @@
+#include "utrace.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define UTRACE_BUFFER 4096   // records a thread collects before writing them out
+#define UTRACE_FORK_SHIFT 40 // forked child n numbers its calls from n << UTRACE_FORK_SHIFT
+
+typedef struct {
+    int thread;
+    int count;
+    utrace_record_t records[UTRACE_BUFFER];
+} trace_buffer_t;
+
+int utrace_enabled = 0;
+
+static int trace_fd = -1;
+static uint64_t trace_start;
+static _Atomic uint64_t trace_seq;
+static _Atomic int trace_threads;
+static _Atomic uint64_t trace_forks;   // children forked so far, counted before each fork
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;   // keeps one buffer's records together in the file
+static pthread_key_t trace_key;
+
+// Buffers come from malloc, not umalloc, so tracing never shows up in the trace or takes room from the allocator
+static __thread trace_buffer_t *buffer;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void write_all(const void *data, size_t bytes) {
+    const char *p = data;
+    while (bytes > 0) {
+        ssize_t n = write(trace_fd, p, bytes);
+        if (n <= 0) {
+            perror("utrace write");
+            return;
+        }
+        p += n;
+        bytes -= n;
+    }
+}
+
+static void flush(trace_buffer_t *b) {
+    if (!b || b->count == 0)
+        return;
+    pthread_mutex_lock(&trace_lock);
+    write_all(b->records, sizeof(utrace_record_t) * b->count);
+    pthread_mutex_unlock(&trace_lock);
+    b->count = 0;
+}
+
+// Runs as each thread exits
+static void release_buffer(void *arg) {
+    flush(arg);
+    free(arg);
+}
+
+// Threads' destructors don't run for the main thread, so it flushes on exit instead
+static void flush_main(void) {
+    flush(buffer);
+}
+
+void utrace_flush(void) {
+    if (utrace_enabled)
+        flush(buffer);
+}
+
+static void count_fork(void) {
+    atomic_fetch_add(&trace_forks, 1);
+}
+
+// The child starts with a copy of the forking thread's buffer, which the parent still writes out itself, and of the
+// parent's sequence counter, which the parent goes on using. Its own calls get a range of numbers of their own.
+static void start_child(void) {
+    if (buffer)
+        buffer->count = 0;
+    atomic_store(&trace_seq, atomic_load(&trace_forks) << UTRACE_FORK_SHIFT);
+}
+
+void utrace_init(void) {
+    if (utrace_enabled)
+        return;
+    const char *path = getenv("UMALLOC_TRACE");
+    if (!path || !*path)
+        return;
+
+    // Appending, so forked children writing to the same file never land on each other's records
+    trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (trace_fd < 0) {
+        perror(path);
+        return;
+    }
+    utrace_header_t header = { UTRACE_MAGIC, UTRACE_VERSION, sizeof(utrace_record_t) };
+    write_all(&header, sizeof(header));
+
+    pthread_key_create(&trace_key, release_buffer);
+    atexit(flush_main);
+    pthread_atfork(count_fork, NULL, start_child);
+    trace_start = now_ns();
+    utrace_enabled = 1;
+}
+
+void utrace_record(int op, uint64_t addr, size_t size) {
+    trace_buffer_t *b = buffer;
+    if (!b) {
+        b = malloc(sizeof(trace_buffer_t));
+        if (!b)
+            return;
+        b->thread = atomic_fetch_add(&trace_threads, 1);
+        b->count = 0;
+        buffer = b;
+        pthread_setspecific(trace_key, b);
+    }
+
+    utrace_record_t *r = &b->records[b->count];
+    r->seq = atomic_fetch_add(&trace_seq, 1);
+    r->time_ns = now_ns() - trace_start;
+    r->addr = addr;
+    r->size = (uint32_t)size;
+    r->thread = (uint16_t)b->thread;
+    r->op = (uint8_t)op;
+    r->pad = 0;
+
+    if (++b->count == UTRACE_BUFFER)
+        flush(b);
+}
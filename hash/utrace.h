@@ -0,0 +1,77 @@
+#ifndef UTRACE_H
+#define UTRACE_H
+
+/* `````````````````````````````````````````````````````````````````````
+ * Allocation Tracing
+ *
+ * Run any of the umalloc variants with UMALLOC_TRACE=<file> and every
+ * umalloc and ufree call is written to <file>, so ureplay can play the
+ * same calls against another allocator (or another build of the same
+ * one) without hashing anything:
+ *
+ *     UMALLOC_TRACE=pi.trace ./esharedhash pi.txt -t
+ *     ./ureplay_esharedhash_b pi.trace
+ *
+ * Each thread fills a buffer of records and appends it to the file when
+ * it is full and when the thread exits, so the only shared state on the
+ * hot path is the sequence counter that puts calls from all threads in
+ * one order. A ufree takes its number before freeing and a umalloc after
+ * returning, so a freed address always comes before the umalloc that
+ * gets it back.
+ *
+ * A forked child (exec_processes.c) traces into the same file with an
+ * empty buffer and sequence numbers starting at n << 40 for the nth
+ * fork, so sorted by seq its calls come after the parent's and after
+ * the children forked before it. It must call utrace_flush before
+ * _exit, since _exit skips the atexit flush.
+ *
+ * File format: a utrace_header_t, then utrace_record_t until the end of
+ * the file, in no particular order. Sort by seq to get the calls in the
+ * order they happened.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define UTRACE_MAGIC 0x45434152544d55ULL   // "UMTRACE"
+#define UTRACE_VERSION 1
+
+enum {
+    UTRACE_ALLOC,     // umalloc, addr is what it returned (0 if it failed)
+    UTRACE_FREE,      // ufree of addr
+    UTRACE_RESET,     // the thread emptied its bump pool, which frees everything in it at once
+};
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t record_size;
+} utrace_header_t;
+
+typedef struct {
+    uint64_t seq;       // position of the call among all threads' calls
+    uint64_t time_ns;   // since tracing started
+    uint64_t addr;
+    uint32_t size;      // bytes asked for, 0 for a ufree
+    uint16_t thread;    // numbered from 0 in the order threads first made a call
+    uint8_t op;
+    uint8_t pad;
+} utrace_record_t;
+
+// Non-zero once utrace_init has opened a trace file
+extern int utrace_enabled;
+
+// Starts tracing if UMALLOC_TRACE names a file. Safe to call more than once.
+void utrace_init(void);
+
+// Takes the address as a number, the memory behind it is never touched
+void utrace_record(int op, uint64_t addr, size_t size);
+
+// Writes out the calling thread's records now, for a process about to _exit
+void utrace_flush(void);
+
+#define UTRACE_ALLOC_CALL(p, size) do { if (utrace_enabled) utrace_record(UTRACE_ALLOC, (uintptr_t)(p), (size)); } while (0)
+#define UTRACE_FREE_CALL(p) do { if (utrace_enabled) utrace_record(UTRACE_FREE, (uintptr_t)(p), 0); } while (0)
+#define UTRACE_RESET_CALL() do { if (utrace_enabled) utrace_record(UTRACE_RESET, 0, 0); } while (0)
+
+#endif
@@ -1,13 +1,24 @@
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 // BEGIN Scheduler Policy
 
 enum scheduler_policy {
 	FIFO = 0, // First-in, first-out
 	SJF = 1, // Shortest-Job-First
-	RR = 2 // Round-Robin
+	RR = 2, // Round-Robin
+	STCF = 3 // Shortest-Time-to-Completion-First (preemptive SJF)
 };
 typedef enum scheduler_policy SchedulerPolicy;
 
@@ -18,6 +29,8 @@ SchedulerPolicy policyFromString(const char* policy) {
 		return SJF;
 	} else if (!strcmp(policy, "RR")) {
 		return RR;
+	} else if (!strcmp(policy, "STCF") || !strcmp(policy, "PSJF")) {
+		return STCF;
 	}
 
 	return FIFO;
@@ -30,6 +43,8 @@ const char* toString(SchedulerPolicy policy) {
 			return "SJF";
 		case RR:
 			return "RR";
+		case STCF:
+			return "STCF";
 		default:
 			return "FIFO";
 	}
@@ -37,129 +52,226 @@ const char* toString(SchedulerPolicy policy) {
 
 // END Scheduler Policy
 
-// BEGIN Job
-struct job {
-	int id;
-	int runtime;
-	struct job* next;
+// BEGIN Random
+
+// Counter-based generator built on the splitmix64 finalizer. A draw is a pure function of (seed, stream, index),
+// so there is no hidden state like srand/rand: any job's values can be computed on its own, in any order or on any
+// thread, and a simulation always reproduces exactly from its seed.
+struct rng {
+	uint64_t key;
 };
-typedef struct job Job;
+typedef struct rng Rng;
 
-// basic tail-insert linked list implementation
-void insert_back(Job** head, Job* element) {
-	element->next = NULL;
+// Streams keep independent quantities (runtimes, arrivals, ...) from drawing the same numbers for the same job
+enum rng_stream {
+	STREAM_RUNTIME = 0,
+	STREAM_ARRIVAL = 1
+};
 
-	if (*head == NULL) {
-		*head = element;
-		return;
-	}
+static uint64_t mix64(uint64_t z) {
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
 
-	Job* p = *head;
-	while (p->next) {
-		p = p->next;
-	}
+Rng rng_create(uint64_t seed, uint64_t stream) {
+	Rng rng;
+	// Mixing twice keeps nearby (seed, stream) pairs from producing overlapping counter sequences
+	rng.key = mix64(mix64(seed) ^ (stream * 0x9E3779B97F4A7C15ULL));
+	return rng;
+}
 
-	p->next = element;
+// Returns the value at position index of this stream
+uint64_t rng_at(const Rng* rng, uint64_t index) {
+	return mix64(rng->key + (index + 1) * 0x9E3779B97F4A7C15ULL);
 }
 
-// Sorted linked list insert for SJF scheduling
-void insert_sorted(Job** head, Job* element) {
-	element->next = NULL; // initialize even tho I mgiht overwrite
-	// If no head only one element
-	if (*head == NULL) {
-		*head = element;
-		return;
-	}
+// Uniform double in [0, 1) like python's random.random(), using the top 53 bits
+double rng_double(const Rng* rng, uint64_t index) {
+	return (double) (rng_at(rng, index) >> 11) * (1.0 / 9007199254740992.0);
+}
 
-	// If smaller than head, insert and become new head
-	if (element->runtime < (*head)->runtime) {
-		element->next = *head;
-		*head = element;
-		return;
+// END Random
+
+// BEGIN Arena
+
+// Bump allocator over one block of memory. The simulator works out how much it needs for the jobs and for the
+// largest run up front, so a whole program (including every run of a sweep) makes a single malloc, and each run
+// only moves the bump pointer back to where the job table ends.
+struct arena {
+	char* base;
+	size_t used;
+	size_t capacity;
+};
+typedef struct arena Arena;
+
+#define ARENA_ALIGN 16
+#define ARENA_ROUND(bytes) (((bytes) + (ARENA_ALIGN - 1)) & ~((size_t) ARENA_ALIGN - 1))
+
+int arena_init(Arena* arena, size_t capacity) {
+	arena->used = 0;
+	arena->capacity = capacity;
+	arena->base = malloc(capacity > 0 ? capacity : 1);
+	if (arena->base == NULL) {
+		perror("malloc");
+		return 1;
 	}
+	return 0;
+}
 
-	// Walk until finding a job w/ a larger runtime. If it doesn't find one it appends to end of the list
-	Job* prev = *head;
-	for (Job* p = (*head)->next; p; p = p->next) {
-		if (element->runtime < p->runtime) {
-			element->next = p;
-			prev->next = element;
-			return;
-		}
-		prev = p;
+void* arena_alloc(Arena* arena, size_t bytes) {
+	bytes = ARENA_ROUND(bytes);
+	if (arena->capacity - arena->used < bytes) {
+		// The sizes are all computed ahead of time so running out means they're wrong, not that memory is short
+		fprintf(stderr, "Error: arena overflow (%zu of %zu bytes used, %zu requested).\n", arena->used, arena->capacity, bytes);
+		abort();
 	}
+	void* p = arena->base + arena->used;
+	arena->used += bytes;
+	return p;
+}
 
-	prev->next = element;
+void arena_reset(Arena* arena, size_t mark) {
+	arena->used = mark;
 }
 
-// Inserts into the linked list based on the policy
-void insert(Job** head, Job* element, SchedulerPolicy policy) {
-	switch (policy) {
-		case FIFO:
-		case RR:
-			insert_back(head, element);
-			break;
-		case SJF:
-			insert_sorted(head, element);
-			break;
-		default:
-			insert_back(head, element);
-			break;
-	}
+void arena_free(Arena* arena) {
+	free(arena->base);
+	arena->base = NULL;
+	arena->used = arena->capacity = 0;
 }
 
-// Always pop's from the head of the linked list. Will be sorted by policy based on the runtime
-Job* pop(Job** head) {
-	if (head == NULL || *head == NULL) {
-		return NULL;
-	}
-	Job* popped = *head;
-	*head = (*head)->next;
-	popped->next = NULL;
-	return popped;
+// END Arena
+
+// BEGIN Job
+
+// All of the jobs as a struct of arrays indexed by job id. A statistics pass only streams through the few arrays it
+// reads instead of hopping between scattered Job structs, and the whole table is one arena allocation.
+struct job_table {
+	int count;
+	int* id; // the job's id, which is its index except in a CPU's private copy of its own jobs
+	int* arrival; // time the job enters the system
+	int* runtime;
+	int* remaining; // time left to run, only changes while simulating
+	int* firstRun; // time the job was first scheduled, -1 until then
+	int* completion; // time the job finished
+	long* order; // sequence number of the last time it was queued, used to break ties in sorted queues
+
+	// Intrusive ready queue links: next for FIFO/RR lists, child/sibling for the SJF/STCF pairing heaps
+	int* next;
+	int* child;
+	int* sibling;
+};
+typedef struct job_table JobTable;
+
+#define JOB_TABLE_INTS 9
+
+static size_t jobTableBytes(int count) {
+	return JOB_TABLE_INTS * ARENA_ROUND(sizeof(int) * (size_t) count) + ARENA_ROUND(sizeof(long) * (size_t) count);
 }
 
-// Cleanly free memory from all objects in this list
-void dispose(Job** head) {
-	if (head == NULL || *head == NULL)
-		return;
+void jobs_init(JobTable* jobs, Arena* arena, int count) {
+	jobs->count = count;
+	jobs->id = arena_alloc(arena, sizeof(int) * count);
+	jobs->arrival = arena_alloc(arena, sizeof(int) * count);
+	jobs->runtime = arena_alloc(arena, sizeof(int) * count);
+	jobs->remaining = arena_alloc(arena, sizeof(int) * count);
+	jobs->firstRun = arena_alloc(arena, sizeof(int) * count);
+	jobs->completion = arena_alloc(arena, sizeof(int) * count);
+	jobs->order = arena_alloc(arena, sizeof(long) * count);
+	jobs->next = arena_alloc(arena, sizeof(int) * count);
+	jobs->child = arena_alloc(arena, sizeof(int) * count);
+	jobs->sibling = arena_alloc(arena, sizeof(int) * count);
+}
 
-	Job* p;
-	while ((p = pop(head))) {
-		free(p);
-	}
-	*head = NULL;
+// END Job
+
+// BEGIN Priority Queue
+
+// Binary min-heap ordered by (key, tie), used for the event queue. Its capacity is fixed when it is created since the
+// simulator knows the most events that can ever be pending at once.
+struct pq_entry {
+	long key;
+	long tie;
+	int job;
+	int type;
+	int token;
+	int cpu;
+};
+typedef struct pq_entry PQEntry;
+
+struct pqueue {
+	PQEntry* data;
+	int size;
+	int capacity;
+};
+typedef struct pqueue PQueue;
+
+static int pq_less(const PQEntry* a, const PQEntry* b) {
+	return a->key < b->key || (a->key == b->key && a->tie < b->tie);
 }
 
-// Makes a (symbolic?) copy of the list
-void clone(Job** dest, const Job** src) {
-	*dest = NULL;
-	if (!src || !*src) {
-		return;
+void pq_init(PQueue* pq, Arena* arena, int capacity) {
+	pq->size = 0;
+	pq->capacity = capacity > 0 ? capacity : 1;
+	pq->data = arena_alloc(arena, sizeof(PQEntry) * pq->capacity);
+}
+
+void pq_push(PQueue* pq, PQEntry entry) {
+	if (pq->size == pq->capacity) {
+		fprintf(stderr, "Error: priority queue overflow (capacity %d).\n", pq->capacity);
+		abort();
 	}
 
-	for (const Job* p = *src; p; p = p->next) {
-		Job* job = malloc(sizeof(Job));
-		job->id = p->id;
-		job->runtime = p->runtime;
-		job->next = NULL;
-		insert_back(dest, job);
+	int i = pq->size++;
+	while (i > 0) {
+		int p = (i - 1) / 2;
+		if (!pq_less(&entry, &pq->data[p])) break;
+		pq->data[i] = pq->data[p];
+		i = p;
 	}
+	pq->data[i] = entry;
 }
 
-// END Job
+PQEntry pq_pop(PQueue* pq) {
+	PQEntry min = pq->data[0];
+	PQEntry last = pq->data[--pq->size];
+	int i = 0;
+	while (1) {
+		int l = 2 * i + 1, r = l + 1, smallest = l;
+		if (l >= pq->size) break;
+		if (r < pq->size && pq_less(&pq->data[r], &pq->data[l])) smallest = r;
+		if (!pq_less(&pq->data[smallest], &last)) break;
+		pq->data[i] = pq->data[smallest];
+		i = smallest;
+	}
+	if (pq->size > 0) {
+		pq->data[i] = last;
+	}
+	return min;
+}
+
+// END Priority Queue
 
 // BEGIN Options
 // this struct is used to store all the options like in the python version
 struct options {
 	int seed;
 	int jobs;
-	const int* jobList;
+	int* jobList;
 	int jobListLen;
+	int* arrivalList;
+	int arrivalListLen;
+	int interarrival;
 	int maxLength;
 	SchedulerPolicy policy;
 	const char* policyString;
+	const char* traceFile;
+	const char* saveTraceFile;
 	int quantum;
+	int cpus;
+	int stealing;
+	int sweep;
 	int compute;
 	int help;
 };
@@ -174,31 +286,132 @@ void printHelp() {
 	printf("  %-22s%s\n", "-s SEED, --seed=SEED", "the random seed");
 	printf("  %-22s%s\n", "-j JOBS, --jobs=JOBS", "number of jobs in the system");
 	printf("  %s\n%-24s%s\n%-24s%s\n" , "-l JLIST, --jlist=JLIST", "", "instead of random jobs, provide a comma-separated list", "", "of run times");
+	printf("  %s\n%-24s%s\n%-24s%s\n" , "-a ALIST, --alist=ALIST", "", "comma-separated list of arrival times, one per job in", "", "the job list (default: every job arrives at 0)");
+	printf("  %s\n%-24s%s\n%-24s%s\n" , "-i MEAN, --interarrival=MEAN", "", "for random jobs, mean time between arrivals", "", "(exponentially distributed, default 0)");
 	printf("  %s\n%-24s%s\n", "-m MAXLEN, --maxlen=MAXLEN", "", "max length of job");
-	printf("  %s\n%-24s%s\n", "-p POLICY, --policy=POLICY", "", "sched policy to use: SJF, FIFO, RR");
+	printf("  %s\n%-24s%s\n", "-p POLICY, --policy=POLICY", "", "sched policy to use: SJF, FIFO, RR, STCF");
 	printf("  %s\n%-24s%s\n", "-q QUANTUM, --quantum=QUANTUM", "", "length of time slice for RR policy");
+	printf("  %s\n%-24s%s\n%-24s%s\n", "--trace=FILE", "", "replay the jobs in FILE instead of -l/-a: CSV lines of", "", "arrival,runtime or the binary format from --save-trace");
+	printf("  %s\n%-24s%s\n", "--save-trace=FILE", "", "write the job list to FILE in the binary trace format");
+	printf("  %-22s%s\n", "--cpus=N", "number of CPUs, each with its own run queue");
+	printf("  %s\n%-24s%s\n%-24s%s\n", "--balance=BALANCE", "", "load balancing between CPUs: steal (idle CPUs take", "", "half of the longest run queue) or none");
+	printf("  %s\n%-24s%s\n%-24s%s\n", "--sweep", "", "compute averages for every policy on the same jobs", "", "instead of a trace for one");
 	printf("  %-22s%s\n", "-c", "compute answers for me");
 
 }
+
+// Prints a list of ints as comma-separated values
+static void printList(const int* list, int len) {
+	for (int i = 0; i < len; i++) {
+		printf("%d", list[i]);
+		if (i != len - 1) {
+			printf(",");
+		}
+	}
+	printf("\n");
+}
+
 void printArguments(Options* opts) {
-	printf("ARG policy %s\n", toString(opts->policy));
-	if (opts->jobList == NULL) {
+	if (opts->sweep) {
+		printf("ARG policy FIFO,SJF,RR,STCF\n");
+	} else {
+		printf("ARG policy %s\n", toString(opts->policy));
+	}
+	if (opts->traceFile != NULL) {
+		// Traces can hold millions of jobs, so don't echo them back
+		printf("ARG trace %s\n", opts->traceFile);
+		printf("ARG jobs %d\n", opts->jobListLen);
+	} else if (opts->jobList == NULL) {
 		printf("ARG jobs %d\n", opts->jobs);
 		printf("ARG maxlen %d\n", opts->maxLength);
 		printf("ARG seed %d\n", opts->seed);
+		if (opts->interarrival > 0) {
+			printf("ARG interarrival %d\n", opts->interarrival);
+		}
 	} else {
 		printf("ARG jlist ");
-		for (int i = 0; i < opts->jobListLen; i++) {
-			printf("%d", opts->jobList[i]);
-			if (i != opts->jobListLen - 1) {
-				printf(",");
-			}
-		}
-		printf("\n");
+		printList(opts->jobList, opts->jobListLen);
+	}
+	if (opts->arrivalList != NULL && opts->traceFile == NULL) {
+		printf("ARG alist ");
+		printList(opts->arrivalList, opts->arrivalListLen);
+	}
+	if (opts->cpus > 1) {
+		printf("ARG cpus %d\n", opts->cpus);
+		printf("ARG balance %s\n", opts->stealing ? "steal" : "none");
 	}
 	printf("\n");
 }
 
+/**
+ * Parses an int at *cursor, stopping at end or the first character that isn't a digit. Leading spaces and tabs are
+ * skipped. Nothing is allocated and the input doesn't need to be NUL terminated, so this works straight out of a
+ * mapped file. Moves *cursor past the number and returns 1, returns 0 if there was no number, or moves past it and
+ * returns -1 if it doesn't fit in an int (more than INT_MAX either way).
+ */
+static int parseInt(const char** cursor, const char* end, int* out) {
+	const char* p = *cursor;
+	while (p < end && (*p == ' ' || *p == '\t')) {
+		p++;
+	}
+
+	int negative = 0;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
+	}
+
+	const char* digits = p;
+	long value = 0;
+	int overflow = 0;
+	while (p < end && *p >= '0' && *p <= '9') {
+		// Stop accumulating once it's too big, but still skip the rest of the digits
+		if (value <= INT_MAX) {
+			value = value * 10 + (*p - '0');
+		}
+		overflow |= value > INT_MAX;
+		p++;
+	}
+	if (p == digits) {
+		return 0;
+	}
+
+	*cursor = p;
+	if (overflow) {
+		return -1;
+	}
+	*out = (int) (negative ? -value : value);
+	return 1;
+}
+
+/**
+ * Parses a comma-separated list of ints into a newly allocated array and stores its length in len. The commas are
+ * counted first so the array is allocated once at the right size. Like atoi, an empty entry counts as 0.
+ */
+int* parseList(const char* list, int* len) {
+	const char* end = list + strlen(list);
+	int count = 1;
+	for (const char* p = list; p < end; p++) {
+		count += *p == ',';
+	}
+
+	int* values = malloc(sizeof(int) * count);
+	const char* p = list;
+	for (int i = 0; i < count; i++) {
+		if (parseInt(&p, end, &values[i]) != 1) {
+			values[i] = 0;
+		}
+		// Skip to just past the next comma
+		while (p < end && *p != ',') {
+			p++;
+		}
+		p++;
+	}
+
+	*len = count;
+	return values;
+}
+
 /**
  * This method parses the arguments passed into the program
  * and puts values into the location provided opts
@@ -210,9 +423,18 @@ void parseArguments(Options* opts, int argc, char** argv) {
 	opts->jobs = 3; // Number of jobs to generate for random gen
 	opts->maxLength = 10; // Max job length for random gen
 	opts->jobList = NULL; // Job list overrides jobs, maxLength,
+	opts->jobListLen = 0;
+	opts->arrivalList = NULL; // Everything arrives at 0 unless told otherwise
+	opts->arrivalListLen = 0;
+	opts->interarrival = 0; // Random jobs all arrive at once by default
+	opts->traceFile = NULL; // Trace overrides the job and arrival lists
+	opts->saveTraceFile = NULL;
 	opts-> policy = FIFO; // Default policy
 	opts->policyString = toString(FIFO); // default policy
 	opts->quantum = 1; // Default quantum
+	opts->cpus = 1; // Single CPU like the python version
+	opts->stealing = 1; // Idle CPUs steal work by default
+	opts->sweep = 0;
 	opts->compute = 0; // Default to false
 
 	for (int i = 0; i < argc; i++) {
@@ -231,252 +453,1081 @@ void parseArguments(Options* opts, int argc, char** argv) {
 			opts->policy = policyFromString(policy);
 		} else if (!strcmp(arg, "-q") || !strcmp(arg, "--quantum")) {
 			opts->quantum = atoi(argv[++i]);
+		} else if (!strcmp(arg, "-i") || !strcmp(arg, "--interarrival")) {
+			opts->interarrival = atoi(argv[++i]);
+		} else if (!strcmp(arg, "--trace")) {
+			opts->traceFile = argv[++i];
+		} else if (!strcmp(arg, "--save-trace")) {
+			opts->saveTraceFile = argv[++i];
+		} else if (!strcmp(arg, "--cpus")) {
+			opts->cpus = atoi(argv[++i]);
+			if (opts->cpus < 1) {
+				opts->cpus = 1;
+			}
+		} else if (!strcmp(arg, "--balance")) {
+			opts->stealing = strcmp(argv[++i], "none") != 0;
+		} else if (!strcmp(arg, "--sweep")) {
+			opts->sweep = 1;
+			opts->compute = 1; // A sweep only makes sense with answers
 		} else if (!strcmp(arg, "-c")) {
 			opts->compute = 1; // Set to true
 		} else if (!strcmp(arg, "-l") || !strcmp(arg, "--jlist")) {
-			const char* jobList = argv[++i];
-			int listLen = strlen(jobList);
-
-			// Idk how many slots I need so this is probably wasteful on space, but more efficient than first counting all of the commas
-			int* jobs = malloc(sizeof(int) * listLen);
-			int jobLen = 0;
-
-			// tl;dr is I wait until i see a comma and take everything up until then and parse into an int and set the
-			// start of the next section (last) as where the comma was
-			int k, last;
-			for (k = 0, last = 0; k <= listLen; k++) {
-				if (jobList[k] == ',' || k == listLen) {
-					// When encountering a comma, get everything from the end of the last token to this
-					char* slice = malloc(sizeof(char) * (k - last + 1));
-					memcpy(slice, &jobList[last], k - last);
-					slice[k - last] = '\0';
-					int dur = atoi(slice);
-					jobs[jobLen++] = dur;
-
-					last = k + 1;
-
-					free(slice);
-				}
-			}
+			opts->jobList = parseList(argv[++i], &opts->jobListLen);
+		} else if (!strcmp(arg, "-a") || !strcmp(arg, "--alist")) {
+			opts->arrivalList = parseList(argv[++i], &opts->arrivalListLen);
+		}
+	}
+}
 
+// END Options
 
-			// Copy the list of jobs into a newly allocated list on the Options struct and free the temp array
-			opts->jobListLen = jobLen;
-			opts->jobList = malloc(sizeof(int) * jobLen);
-			memcpy(opts->jobList, jobs, jobLen * sizeof(int));
+// BEGIN Trace
 
-			free(jobs);
+/**
+ * Workload traces hold one (arrival, runtime) pair per job, in job id order. Two formats are accepted:
+ *   - CSV: one "arrival,runtime" line per job. Blank lines, lines starting with '#' and a header line are skipped.
+ *   - Binary: the 4 bytes "SJT1", a little-endian uint32 job count, then count pairs of little-endian uint32
+ *     arrival and runtime. This is what --save-trace writes.
+ * The file is mapped rather than read, and parsing never allocates per line, so multi-million job traces load in
+ * about the time it takes to touch the pages.
+ */
+#define TRACE_MAGIC "SJT1"
+#define TRACE_HEADER_SIZE 8
+#define TRACE_RECORD_SIZE 8
+
+struct mapped_file {
+	const char* data;
+	size_t size;
+#ifdef _WIN32
+	char* buffer;
+#endif
+};
+typedef struct mapped_file MappedFile;
+
+// Maps the whole file read-only. There's no mmap on Windows so it is read into memory there instead.
+static int mapFile(const char* path, MappedFile* file) {
+	file->data = NULL;
+	file->size = 0;
+#ifdef _WIN32
+	FILE* fp = fopen(path, "rb");
+	if (fp == NULL) {
+		perror(path);
+		return 1;
+	}
+	fseek(fp, 0, SEEK_END);
+	file->size = (size_t) ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	file->buffer = malloc(file->size + 1);
+	if (fread(file->buffer, 1, file->size, fp) != file->size) {
+		perror(path);
+		fclose(fp);
+		free(file->buffer);
+		return 1;
+	}
+	fclose(fp);
+	file->data = file->buffer;
+	return 0;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		perror(path);
+		return 1;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		perror(path);
+		close(fd);
+		return 1;
+	}
+	file->size = (size_t) st.st_size;
+	if (file->size > 0) {
+		void* data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			perror("mmap");
+			close(fd);
+			return 1;
 		}
+		// The trace is read once from front to back
+		madvise(data, file->size, MADV_SEQUENTIAL);
+		file->data = data;
 	}
+	close(fd);
+	return 0;
+#endif
 }
 
-// END Options
-
-void compute(Job** readyQueue, const Options* opts);
-void createJobs(Job** readyQueue, const Options* opts);
+static void unmapFile(MappedFile* file) {
+#ifdef _WIN32
+	free(file->buffer);
+#else
+	if (file->data != NULL) {
+		munmap((void*) file->data, file->size);
+	}
+#endif
+	file->data = NULL;
+}
 
-int main(int argc, char** argv) {
+static uint32_t readU32(const unsigned char* p) {
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
 
-	Options opts;
-	parseArguments(&opts, argc, argv);
+static void writeU32(unsigned char* p, uint32_t value) {
+	p[0] = (unsigned char) value;
+	p[1] = (unsigned char) (value >> 8);
+	p[2] = (unsigned char) (value >> 16);
+	p[3] = (unsigned char) (value >> 24);
+}
 
-	if (opts.help) {
-		printHelp();
-		return 0;
+// The caller has checked the file holds as many records as its header says
+static int parseBinaryTrace(const MappedFile* file, const char* path, int* runtimes, int* arrivals, int* count) {
+	const unsigned char* data = (const unsigned char*) file->data;
+	const uint32_t jobs = readU32(data + 4);
+
+	const unsigned char* record = data + TRACE_HEADER_SIZE;
+	for (uint32_t i = 0; i < jobs; i++, record += TRACE_RECORD_SIZE) {
+		const uint32_t arrival = readU32(record);
+		const uint32_t runtime = readU32(record + 4);
+		if (arrival > INT_MAX || runtime > INT_MAX || runtime == 0) {
+			fprintf(stderr, "Error: %s: job %u: expected arrival and runtime of at most %d, and a runtime above 0.\n",
+				path, i, INT_MAX);
+			return 1;
+		}
+		arrivals[i] = (int) arrival;
+		runtimes[i] = (int) runtime;
 	}
+	*count = (int) jobs;
+	return 0;
+}
 
-	printArguments(&opts);
+static int parseCsvTrace(const MappedFile* file, const char* path, int* runtimes, int* arrivals, int* count) {
+	const char* p = file->data;
+	const char* end = file->data + file->size;
+	int jobs = 0;
+	int line = 0;
+
+	while (p < end) {
+		const char* eol = memchr(p, '\n', (size_t) (end - p));
+		if (eol == NULL) {
+			eol = end;
+		}
+		line++;
+
+		const char* cursor = p;
+		int arrival, runtime;
+		const int arrivalParsed = parseInt(&cursor, eol, &arrival);
+		if (arrivalParsed != 0) {
+			// Allow spaces around the comma and a trailing \r from Windows line endings
+			while (cursor < eol && (*cursor == ' ' || *cursor == '\t')) {
+				cursor++;
+			}
+			int runtimeParsed = 0;
+			if (cursor >= eol || *cursor != ',' || (cursor++, (runtimeParsed = parseInt(&cursor, eol, &runtime)) == 0)) {
+				fprintf(stderr, "Error: %s:%d: expected arrival,runtime.\n", path, line);
+				return 1;
+			}
+			while (cursor < eol && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) {
+				cursor++;
+			}
+			if (cursor < eol) {
+				fprintf(stderr, "Error: %s:%d: expected arrival,runtime.\n", path, line);
+				return 1;
+			}
+			if (arrivalParsed < 0 || runtimeParsed < 0) {
+				fprintf(stderr, "Error: %s:%d: arrival and runtime must be at most %d.\n", path, line, INT_MAX);
+				return 1;
+			}
+			if (arrival < 0) {
+				fprintf(stderr, "Error: %s:%d: arrival must be 0 or more.\n", path, line);
+				return 1;
+			}
+			if (runtime <= 0) {
+				fprintf(stderr, "Error: %s:%d: runtime must be above 0.\n", path, line);
+				return 1;
+			}
+			arrivals[jobs] = arrival;
+			runtimes[jobs] = runtime;
+			jobs++;
+		} else {
+			// Anything that doesn't start with a number is a header, comment or blank line, but only a header can
+			// come before the first job
+			while (cursor < eol && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) {
+				cursor++;
+			}
+			if (cursor < eol && *cursor != '#' && jobs > 0) {
+				fprintf(stderr, "Error: %s:%d: expected arrival,runtime.\n", path, line);
+				return 1;
+			}
+		}
 
-	Job* readyQueue = NULL;
+		p = eol + 1;
+	}
 
-	// I'm passing a reference to the array which makes it way easier to manage the memory in the list
-	createJobs(&readyQueue, &opts);
+	*count = jobs;
+	return 0;
+}
 
-	if (opts.compute) {
-		compute(&readyQueue, &opts);
+/**
+ * Loads opts->traceFile into the job and arrival lists, replacing anything given with -l or -a.
+ * Returns nonzero if the file can't be read or isn't a valid trace.
+ */
+int loadTrace(Options* opts) {
+	MappedFile file;
+	if (mapFile(opts->traceFile, &file)) {
+		return 1;
+	}
+
+	// Size the lists once: binary traces say how many jobs they have, and a CSV has at most one per line
+	const int binary = file.size >= TRACE_HEADER_SIZE && memcmp(file.data, TRACE_MAGIC, 4) == 0;
+	size_t capacity = 1;
+	if (binary) {
+		// Check the header against the file before trusting it with an allocation
+		const uint32_t jobs = readU32((const unsigned char*) file.data + 4);
+		if ((file.size - TRACE_HEADER_SIZE) / TRACE_RECORD_SIZE < jobs) {
+			fprintf(stderr, "Error: %s is truncated, expected %u jobs.\n", opts->traceFile, jobs);
+			unmapFile(&file);
+			return 1;
+		}
+		capacity += jobs;
 	} else {
-		printf("Compute the turnaround time, response time, and wait time for each job.\n");
-		printf("When you are done, run this program again, with the same arguments,\n");
-		printf("but with -c, which will thus provide you with the answers. You can use\n");
-		printf("-s <somenumber> or your own job list (-l 10,15,20 for example)\n");
-		printf("to generate different problems for yourself.\n\n");
+		for (const char* p = file.data; p != NULL && p < file.data + file.size; p++) {
+			p = memchr(p, '\n', (size_t) (file.data + file.size - p));
+			if (p == NULL) break;
+			capacity++;
+		}
+	}
+	if (capacity > (size_t) INT32_MAX / sizeof(int)) {
+		fprintf(stderr, "Error: %s has too many jobs.\n", opts->traceFile);
+		unmapFile(&file);
+		return 1;
 	}
 
+	free(opts->jobList);
+	free(opts->arrivalList);
+	opts->jobList = malloc(sizeof(int) * capacity);
+	opts->arrivalList = malloc(sizeof(int) * capacity);
+	if (opts->jobList == NULL || opts->arrivalList == NULL) {
+		fprintf(stderr, "Error: not enough memory for %zu jobs from %s.\n", capacity - 1, opts->traceFile);
+		free(opts->jobList);
+		free(opts->arrivalList);
+		opts->jobList = NULL;
+		opts->arrivalList = NULL;
+		opts->jobListLen = 0;
+		opts->arrivalListLen = 0;
+		unmapFile(&file);
+		return 1;
+	}
+
+	int count = 0;
+	int failed = binary
+		? parseBinaryTrace(&file, opts->traceFile, opts->jobList, opts->arrivalList, &count)
+		: parseCsvTrace(&file, opts->traceFile, opts->jobList, opts->arrivalList, &count);
+	unmapFile(&file);
+
+	opts->jobListLen = count;
+	opts->arrivalListLen = count;
+	return failed;
+}
 
-	// No longer using the jobs queue so free up the memory again
-	dispose(&readyQueue);
+// Writes the jobs to path in the binary trace format
+int saveTrace(const char* path, const JobTable* jobs) {
+	FILE* fp = fopen(path, "wb");
+	if (fp == NULL) {
+		perror(path);
+		return 1;
+	}
 
-	if (opts.jobList != NULL) {
-		free(opts.jobList);
+	unsigned char header[TRACE_HEADER_SIZE];
+	memcpy(header, TRACE_MAGIC, 4);
+	writeU32(header + 4, (uint32_t) jobs->count);
+	fwrite(header, 1, sizeof(header), fp);
+
+	for (int i = 0; i < jobs->count; i++) {
+		unsigned char record[TRACE_RECORD_SIZE];
+		writeU32(record, (uint32_t) jobs->arrival[i]);
+		writeU32(record + 4, (uint32_t) jobs->runtime[i]);
+		fwrite(record, 1, sizeof(record), fp);
 	}
 
+	if (fclose(fp) != 0) {
+		perror(path);
+		return 1;
+	}
 	return 0;
 }
 
-// Creates jobs and adds them to the ready queue. Also prints them.
-void createJobs(Job** readyQueue, const Options* opts) {
-	srand(opts->seed);
-	if (opts->jobList == NULL) {
-		// Generate random jobs
-		for (int i = 0; i < opts->jobs; i++) {
-			Job* job = malloc(sizeof(Job));
-			job->id = i;
-			job->runtime = rand() % opts->maxLength + 1;
-			insert_back(readyQueue, job);
+// END Trace
+
+// BEGIN Simulation
+
+// Events at the same time are handled in this order: new jobs are queued before the running one is put back, which
+// matches a real run queue where a job whose slice just expired goes behind everything already waiting.
+enum event_type {
+	ARRIVAL = 0,
+	QUANTUM_EXPIRY = 1,
+	COMPLETION = 2
+};
+
+// One line of the execution trace. A slice is logged when it starts and filled in when it ends, and since time only
+// moves forward the log of a simulation is always in start order.
+struct slice {
+	int start;
+	int length;
+	int jobId; // -1 for time spent idle
+	short cpu;
+	short done;
+};
+typedef struct slice Slice;
+
+// One CPU with its own run queue. FIFO and RR use an intrusive list through the job table's next links, SJF and STCF
+// a pairing heap through its child/sibling links, keyed on time left. Neither needs any memory of its own.
+struct cpu {
+	int index;
+	int readyHead; // list head, or heap root
+	int readyTail;
+	int readyCount;
+
+	int running; // job on the CPU, -1 when idle
+	int sliceStart;
+	int slice; // index of the running job's trace slice
+	int token; // bumped whenever the running job changes so stale completion/expiry events can be ignored
+
+	long busy; // total time spent running jobs
+	int completed;
+	int steals; // how many times this CPU took work from another one
+	int stolen; // how many jobs it took
+};
+typedef struct cpu Cpu;
+
+// State of one simulation run. Nothing in here is global, so independent simulations can run side by side.
+struct simulation {
+	JobTable* jobs;
+	SchedulerPolicy policy;
+	int quantum;
+	int stealing;
+	int logIdle;
+	PQueue events;
+	long sequence; // increases every time something is queued, keeps equal keys in insertion order
+	Cpu* cpus;
+	int numCpus;
+	int totalCpus; // CPUs in the whole system, a simulation of one of them still places jobs by this
+
+	Slice* trace; // NULL when the trace isn't wanted
+	int traceCount;
+	int traceCapacity;
+
+	int* finished; // jobs in the order they completed
+	int* finishedCpu; // CPU each of them finished on
+	int finishedCount;
+};
+typedef struct simulation Simulation;
+
+static int usesHeap(SchedulerPolicy policy) {
+	return policy == SJF || policy == STCF;
+}
+
+// Cpus are addressed by their real number, a simulation of a single CPU out of many only holds that one
+static Cpu* cpuAt(Simulation* sim, int index) {
+	return sim->numCpus == 1 ? &sim->cpus[0] : &sim->cpus[index];
+}
+
+static void pushEvent(Simulation* sim, int time, int type, int job, int cpu, int token) {
+	PQEntry event;
+	// Type goes in the low bits of the key so simultaneous events are handled in enum order
+	event.key = (long) time * 4 + type;
+	event.tie = sim->sequence++;
+	event.job = job;
+	event.type = type;
+	event.token = token;
+	event.cpu = cpu;
+	pq_push(&sim->events, event);
+}
+
+static int heapLess(const JobTable* jobs, int a, int b) {
+	return jobs->remaining[a] < jobs->remaining[b] || (jobs->remaining[a] == jobs->remaining[b] && jobs->order[a] < jobs->order[b]);
+}
+
+// Links two pairing heap roots, the larger one becomes the first child of the smaller
+static int heapMeld(JobTable* jobs, int a, int b) {
+	if (a == -1) return b;
+	if (b == -1) return a;
+	if (heapLess(jobs, b, a)) {
+		int t = a; a = b; b = t;
+	}
+	jobs->sibling[b] = jobs->child[a];
+	jobs->child[a] = b;
+	return a;
+}
+
+// Standard two-pass pairing: meld the children in pairs left to right, then fold the pairs right to left. The
+// first pass reverses the list through the sibling links so neither pass needs a stack.
+static int heapPopRoot(JobTable* jobs, int root) {
+	int paired = -1;
+	int c = jobs->child[root];
+	while (c != -1) {
+		int a = c;
+		int b = jobs->sibling[a];
+		c = b == -1 ? -1 : jobs->sibling[b];
+		jobs->sibling[a] = -1;
+		if (b != -1) {
+			jobs->sibling[b] = -1;
+			a = heapMeld(jobs, a, b);
 		}
+		jobs->sibling[a] = paired;
+		paired = a;
+	}
+
+	int result = -1;
+	while (paired != -1) {
+		int nextPair = jobs->sibling[paired];
+		jobs->sibling[paired] = -1;
+		result = heapMeld(jobs, result, paired);
+		paired = nextPair;
+	}
+	jobs->child[root] = -1;
+	return result;
+}
+
+static void enqueueReady(Simulation* sim, Cpu* cpu, int job) {
+	JobTable* jobs = sim->jobs;
+	jobs->order[job] = sim->sequence++;
+	cpu->readyCount++;
+
+	if (usesHeap(sim->policy)) {
+		jobs->child[job] = -1;
+		jobs->sibling[job] = -1;
+		cpu->readyHead = heapMeld(jobs, cpu->readyHead, job);
+		return;
+	}
+
+	jobs->next[job] = -1;
+	if (cpu->readyTail == -1) {
+		cpu->readyHead = job;
 	} else {
-		for (int i = 0; i < opts->jobListLen; i++) {
-			Job* job = malloc(sizeof(Job));
-			job->id = i;
-			job->runtime = opts->jobList[i];
-			insert_back(readyQueue, job);
+		jobs->next[cpu->readyTail] = job;
+	}
+	cpu->readyTail = job;
+}
+
+static int dequeueReady(Simulation* sim, Cpu* cpu) {
+	if (cpu->readyCount == 0) {
+		return -1;
+	}
+	cpu->readyCount--;
+
+	const int job = cpu->readyHead;
+	if (usesHeap(sim->policy)) {
+		cpu->readyHead = heapPopRoot(sim->jobs, job);
+		return job;
+	}
+
+	cpu->readyHead = sim->jobs->next[job];
+	if (cpu->readyHead == -1) {
+		cpu->readyTail = -1;
+	}
+	return job;
+}
+
+// Starts a trace slice and returns its index, or -1 when not tracing
+static int logSlice(Simulation* sim, const Cpu* cpu, int start, int length, int jobId) {
+	if (sim->trace == NULL) {
+		return -1;
+	}
+	if (sim->traceCount == sim->traceCapacity) {
+		fprintf(stderr, "Error: trace overflow (capacity %d).\n", sim->traceCapacity);
+		abort();
+	}
+	Slice* slice = &sim->trace[sim->traceCount];
+	slice->start = start;
+	slice->length = length;
+	slice->jobId = jobId;
+	slice->cpu = (short) cpu->index;
+	slice->done = 0;
+	return sim->traceCount++;
+}
+
+// Gives the CPU to the next ready job and schedules the event that will end its slice
+static void dispatch(Simulation* sim, Cpu* cpu, int theTime) {
+	JobTable* jobs = sim->jobs;
+	const int job = dequeueReady(sim, cpu);
+	if (jobs->firstRun[job] == -1) {
+		jobs->firstRun[job] = theTime;
+	}
+
+	int slice = jobs->remaining[job];
+	int type = COMPLETION;
+	if (sim->policy == RR && jobs->remaining[job] > sim->quantum) {
+		slice = sim->quantum;
+		type = QUANTUM_EXPIRY;
+	}
+
+	cpu->running = job;
+	cpu->sliceStart = theTime;
+	cpu->slice = logSlice(sim, cpu, theTime, 0, jobs->id[job]);
+	pushEvent(sim, theTime + slice, type, job, cpu->index, ++cpu->token);
+}
+
+// Takes the running job off the CPU at theTime, charging it for the time it ran
+static int deschedule(Simulation* sim, Cpu* cpu, int theTime, int done) {
+	const int job = cpu->running;
+	const int ranFor = theTime - cpu->sliceStart;
+	if (cpu->slice != -1) {
+		sim->trace[cpu->slice].length = ranFor;
+		sim->trace[cpu->slice].done = (short) done;
+	}
+	sim->jobs->remaining[job] -= ranFor;
+	cpu->busy += ranFor;
+
+	cpu->running = -1;
+	cpu->token++; // anything still queued for this slice is now stale
+	return job;
+}
+
+// Jobs that finish at the same instant are listed by CPU number, the same order a merge of per-CPU lists would give
+static void recordFinished(Simulation* sim, const Cpu* cpu, int job, int theTime) {
+	int k = sim->finishedCount++;
+	while (k > 0 && sim->finishedCpu[k - 1] > cpu->index && sim->jobs->completion[sim->finished[k - 1]] == theTime) {
+		sim->finished[k] = sim->finished[k - 1];
+		sim->finishedCpu[k] = sim->finishedCpu[k - 1];
+		k--;
+	}
+	sim->finished[k] = job;
+	sim->finishedCpu[k] = cpu->index;
+}
+
+static void handleEvent(Simulation* sim, const PQEntry* event, int theTime) {
+	Cpu* cpu = cpuAt(sim, event->cpu);
+	switch (event->type) {
+		case ARRIVAL:
+			enqueueReady(sim, cpu, event->job);
+			break;
+		case QUANTUM_EXPIRY:
+			if (event->token != cpu->token) break;
+			enqueueReady(sim, cpu, deschedule(sim, cpu, theTime, 0));
+			break;
+		case COMPLETION:
+			if (event->token != cpu->token) break;
+			deschedule(sim, cpu, theTime, 1);
+			sim->jobs->completion[event->job] = theTime;
+			recordFinished(sim, cpu, event->job, theTime);
+			cpu->completed++;
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+ * Work stealing: an idle CPU with nothing queued takes half of the jobs from the CPU with the most waiting work.
+ * Jobs come off the front of the victim's queue, so whatever has waited longest (or is shortest, for SJF and STCF)
+ * gets to run soonest.
+ */
+static void steal(Simulation* sim, Cpu* thief) {
+	Cpu* victim = NULL;
+	int most = 0;
+	for (int i = 0; i < sim->numCpus; i++) {
+		Cpu* cpu = &sim->cpus[i];
+		// An idle CPU is about to run the head of its own queue, so that job isn't up for grabs
+		const int spare = cpu->readyCount - (cpu->running == -1 ? 1 : 0);
+		if (cpu != thief && spare > most) {
+			most = spare;
+			victim = cpu;
 		}
 	}
+	if (victim == NULL) {
+		return;
+	}
 
-	printf("Here is the job list, with the run time of each job: \n");
-	// Separated printing here to reduce repetition of code. Just has to iterate over list once more.
-	for (Job* p = *readyQueue; p; p = p->next) {
-		printf("  Job %d ( length = %.1f )\n", p->id, (float) p->runtime);
+	const int take = (most + 1) / 2;
+	for (int i = 0; i < take; i++) {
+		enqueueReady(sim, thief, dequeueReady(sim, victim));
 	}
-	printf("\n\n");
+	thief->steals++;
+	thief->stolen += take;
 }
 
-void computeFIFO(Job** readyQueue, const Options* opts) {
-	int theTime = 0;
-	printf("Execution trace:\n");
-	for (const Job* job = *readyQueue; job; job = job->next) {
-		printf("  [ time %3d ] Run job %d for %.2f secs ( DONE at %.2f )\n", theTime, job->id, (float) job->runtime, (float) theTime + (float) job->runtime);
-		theTime += job->runtime;
+/**
+ * Discrete-event simulation of the CPUs in sim. Time jumps straight from one event to the next, so the cost depends
+ * on the number of arrivals, completions and expired slices rather than on how long the workload takes to run.
+ * Jobs are placed on CPU (id % CPUs) when they arrive, which makes every CPU independent unless stealing is on.
+ */
+static void simulate(Simulation* sim) {
+	JobTable* jobs = sim->jobs;
+	for (int i = 0; i < jobs->count; i++) {
+		jobs->remaining[i] = jobs->runtime[i];
+		jobs->firstRun[i] = -1;
+		jobs->completion[i] = 0;
+		pushEvent(sim, jobs->arrival[i], ARRIVAL, i, jobs->id[i] % sim->totalCpus, 0);
 	}
-	printf("\nFinal statistics:\n");
 
-	float t = 0.0f;
-	int count = 0;
-	float turnaroundSum = 0.0f;
-	float waitSum = 0.0f;
-	float responseSum = 0.0f;
-	for (const Job* job = *readyQueue; job; job = job->next) {
-		const int jobId = job->id;
-		const float runtime = (float) job->runtime;
-		const float response = t;
-		const float turnaround = t + runtime;
-		const float wait = t;
-		printf("  Job %3d -- Response: %3.2f  Turnaround %3.2f  Wait %3.2f\n", jobId, response, turnaround, wait);
-		responseSum += response;
-		turnaroundSum += turnaround;
-		waitSum += wait;
-		t += runtime;
-		count++;
-	}
-	printf("\n  Average -- Response: %3.2f  Turnaround %3.2f  Wait %3.2f\n\n", responseSum / (float) count, turnaroundSum / (float) count, waitSum / (float) count);
-}
-
-// This structure is used to store the data of each job status instead of having 5 different arrays
-struct JobStatus {
-	int id;
-	int turnaround;
-	int response;
-	int lastRan;
-	int wait;
+	while (sim->events.size > 0) {
+		// Handle everything that happens at this instant before deciding who runs, so SJF sees all of the jobs that
+		// arrived together and not just the first one
+		const long now = sim->events.data[0].key / 4;
+		while (sim->events.size > 0 && sim->events.data[0].key / 4 == now) {
+			PQEntry event = pq_pop(&sim->events);
+			handleEvent(sim, &event, (int) now);
+		}
+
+		// STCF preempts the running job as soon as something shorter shows up
+		if (sim->policy == STCF) {
+			for (int i = 0; i < sim->numCpus; i++) {
+				Cpu* cpu = &sim->cpus[i];
+				if (cpu->running == -1 || cpu->readyCount == 0) continue;
+				const int left = jobs->remaining[cpu->running] - ((int) now - cpu->sliceStart);
+				if (jobs->remaining[cpu->readyHead] < left) {
+					enqueueReady(sim, cpu, deschedule(sim, cpu, (int) now, 0));
+				}
+			}
+		}
+
+		if (sim->stealing) {
+			for (int i = 0; i < sim->numCpus; i++) {
+				Cpu* cpu = &sim->cpus[i];
+				if (cpu->running == -1 && cpu->readyCount == 0) {
+					steal(sim, cpu);
+				}
+			}
+		}
+
+		for (int i = 0; i < sim->numCpus; i++) {
+			Cpu* cpu = &sim->cpus[i];
+			if (cpu->running == -1 && cpu->readyCount > 0) {
+				dispatch(sim, cpu, (int) now);
+			} else if (sim->logIdle && cpu->running == -1 && sim->events.size > 0) {
+				const int next = (int) (sim->events.data[0].key / 4);
+				logSlice(sim, cpu, (int) now, next - (int) now, -1);
+			}
+		}
+	}
+}
+
+// A CPU whose event stream doesn't depend on any other CPU, simulated on its own thread with a private copy of its
+// jobs so that no two threads ever write to the same cache line of the job table
+struct partition {
+	Simulation sim;
+	JobTable jobs;
 };
-typedef struct JobStatus JobStatus;
+typedef struct partition Partition;
+
+static void* simulatePartition(void* arg) {
+	Partition* part = (Partition*) arg;
+	simulate(&part->sim);
+	return NULL;
+}
+
+// Trace slices to budget for a job under a policy: one per quantum for RR, and two for STCF since every arrival can
+// cut at most one running job in two
+static long slicesFor(SchedulerPolicy policy, int quantum, int runtime) {
+	if (policy == RR && quantum > 0 && runtime > quantum) {
+		return (runtime + quantum - 1) / quantum;
+	}
+	return policy == STCF ? 2 : 1;
+}
+
+// Upper bound on a job's runtime known before the jobs are created, used to size the trace
+static int runtimeBound(const Options* opts, int job) {
+	return opts->jobList != NULL ? opts->jobList[job] : opts->maxLength;
+}
+
+/**
+ * Bytes one run of policy needs beyond the job table: CPUs, the event heap (every arrival, one live event per CPU
+ * and at most one stale completion per STCF preemption), the finished list and the trace. Partitioned runs also
+ * copy each CPU's jobs into their own table.
+ */
+static size_t runBytes(const Options* opts, SchedulerPolicy policy, int totalJobs, int withTrace) {
+	const int numCpus = opts->cpus;
+	size_t bytes = ARENA_ROUND(sizeof(Cpu) * numCpus);
+
+	const int partitioned = numCpus > 1 && !opts->stealing;
+	const int groups = partitioned ? numCpus : 1;
+	if (partitioned) {
+		bytes += ARENA_ROUND(sizeof(Partition) * numCpus) + ARENA_ROUND(sizeof(pthread_t) * numCpus);
+	}
+
+	for (int g = 0; g < groups; g++) {
+		const int step = partitioned ? numCpus : 1;
+		int count = 0;
+		long slices = 0;
+		for (int i = g; i < totalJobs; i += step) {
+			count++;
+			slices += slicesFor(policy, opts->quantum, runtimeBound(opts, i));
+		}
+		if (numCpus == 1) {
+			slices += count + 1; // idle gaps, at most one before each arrival
+		}
+
+		if (partitioned) {
+			bytes += jobTableBytes(count);
+		}
+		bytes += ARENA_ROUND(sizeof(PQEntry) * (2 * (size_t) count + numCpus + 1));
+		bytes += 2 * ARENA_ROUND(sizeof(int) * (size_t) (count > 0 ? count : 1));
+		if (withTrace) {
+			bytes += ARENA_ROUND(sizeof(Slice) * (size_t) (slices > 0 ? slices : 1));
+		}
+	}
+	return bytes;
+}
+
+static void initSimulation(Simulation* sim, Arena* arena, const Options* opts, SchedulerPolicy policy, JobTable* jobs, Cpu* cpus, int numCpus, int withTrace) {
+	memset(sim, 0, sizeof(Simulation));
+	sim->jobs = jobs;
+	sim->policy = policy;
+	sim->quantum = opts->quantum;
+	sim->stealing = opts->stealing && numCpus > 1;
+	sim->logIdle = opts->cpus == 1;
+	sim->cpus = cpus;
+	sim->numCpus = numCpus;
+	sim->totalCpus = opts->cpus;
+	pq_init(&sim->events, arena, 2 * jobs->count + numCpus + 1);
+	sim->finished = arena_alloc(arena, sizeof(int) * (jobs->count > 0 ? jobs->count : 1));
+	sim->finishedCpu = arena_alloc(arena, sizeof(int) * (jobs->count > 0 ? jobs->count : 1));
+
+	if (withTrace) {
+		long slices = numCpus == 1 && opts->cpus == 1 ? jobs->count + 1 : 0;
+		for (int i = 0; i < jobs->count; i++) {
+			slices += slicesFor(policy, opts->quantum, jobs->runtime[i]);
+		}
+		sim->traceCapacity = (int) slices;
+		sim->trace = arena_alloc(arena, sizeof(Slice) * (size_t) (slices > 0 ? slices : 1));
+	}
+
+	for (int i = 0; i < numCpus; i++) {
+		Cpu* cpu = &cpus[i];
+		// A partition's single CPU was already given its real number
+		const int index = numCpus == 1 ? cpu->index : i;
+		memset(cpu, 0, sizeof(Cpu));
+		cpu->index = index;
+		cpu->readyHead = cpu->readyTail = -1;
+		cpu->running = -1;
+		cpu->slice = -1;
+	}
+}
+
+/**
+ * Runs the jobs on opts->cpus CPUs and fills in every job's firstRun and completion. Without stealing each CPU only
+ * ever sees its own jobs, so causality allows every CPU's event stream to be simulated on a separate thread. With
+ * stealing the CPUs interact at every idle moment and share one event queue.
+ * Returns the simulations that ran (one, or one per CPU) so the caller can read their traces and completion order.
+ */
+static Simulation* runCpus(Arena* arena, JobTable* jobs, const Options* opts, SchedulerPolicy policy, Cpu* cpus, int withTrace, int* numSims) {
+	const int numCpus = opts->cpus;
+
+	if (numCpus == 1 || opts->stealing) {
+		Simulation* sim = arena_alloc(arena, sizeof(Simulation));
+		initSimulation(sim, arena, opts, policy, jobs, cpus, numCpus, withTrace);
+		simulate(sim);
+		*numSims = 1;
+		return sim;
+	}
+
+	Partition* parts = arena_alloc(arena, sizeof(Partition) * numCpus);
+	pthread_t* threads = arena_alloc(arena, sizeof(pthread_t) * numCpus);
+
+	// Copy each CPU's jobs into a private table, keeping id order
+	for (int c = 0; c < numCpus; c++) {
+		Partition* part = &parts[c];
+		const int count = jobs->count > c ? (jobs->count - c + numCpus - 1) / numCpus : 0;
+		jobs_init(&part->jobs, arena, count);
+		for (int k = 0, i = c; i < jobs->count; k++, i += numCpus) {
+			part->jobs.id[k] = i;
+			part->jobs.arrival[k] = jobs->arrival[i];
+			part->jobs.runtime[k] = jobs->runtime[i];
+		}
+		cpus[c].index = c;
+		initSimulation(&part->sim, arena, opts, policy, &part->jobs, &cpus[c], 1, withTrace);
+	}
+
+	int started = 0;
+	for (; started < numCpus; started++) {
+		if (pthread_create(&threads[started], NULL, simulatePartition, &parts[started])) {
+			perror("pthread_create");
+			break;
+		}
+	}
+	// Anything that couldn't get a thread is simulated right here
+	for (int c = started; c < numCpus; c++) {
+		simulatePartition(&parts[c]);
+	}
+	for (int c = 0; c < started; c++) {
+		pthread_join(threads[c], NULL);
+	}
 
-void computeRR(Job** jobs, const Options* opts) {
+	// Copy the results back into the shared table. The simulations stay in place inside the partitions.
+	Simulation* sims = arena_alloc(arena, sizeof(Simulation) * numCpus);
+	for (int c = 0; c < numCpus; c++) {
+		const JobTable* local = &parts[c].jobs;
+		for (int k = 0; k < local->count; k++) {
+			jobs->firstRun[local->id[k]] = local->firstRun[k];
+			jobs->completion[local->id[k]] = local->completion[k];
+		}
+		sims[c] = parts[c].sim;
+	}
+	*numSims = numCpus;
+	return sims;
+}
+
+// Merges the simulations' traces by start time (then CPU number) and prints them
+static void printTrace(SchedulerPolicy policy, const Simulation* sims, int numSims, int numCpus) {
+	int pos[numSims];
+	memset(pos, 0, sizeof(pos));
 	printf("Execution trace:\n");
-	const int totalJobs = opts->jobList != NULL ? opts->jobListLen : opts->jobs;
-
-	// Using a struct for job status info instead of handling 5 different arrays
-	JobStatus** statuses = malloc(sizeof(JobStatus*) * totalJobs);
-	int quantum = opts->quantum;
-	int jobCount = totalJobs;
-
-	for (int i = 0; i < totalJobs; i++) {
-		statuses[i] = malloc(sizeof(JobStatus));
-		JobStatus* status = statuses[i];
-		status->id = i;
-		status->lastRan = 0;
-		status->wait = 0;
-		status->turnaround = 0;
-		status->response = -1;
-	}
-
-	// Copy the job list
-	Job* runList;
-	clone(&runList, jobs);
-
-	int theTime = 0;
-	while (jobCount > 0) {
-		Job* job = pop(&runList);
-		const int jobId = job->id;
-		JobStatus* status = statuses[jobId];
-		if (status->response == -1) {
-			status->response = theTime;
-		}
-		const int currentWait = theTime - status->lastRan;
-		status->wait += currentWait;
-		int ranFor;
-		if (job->runtime > quantum) {
-			job->runtime -= quantum;
-			ranFor = quantum;
-			insert(&runList, job, opts->policy);
-			printf("  [ time %3d ] Run job %3d for %.2f secs\n", theTime, jobId, (float) ranFor);
+	while (1) {
+		int best = -1;
+		for (int s = 0; s < numSims; s++) {
+			if (pos[s] < sims[s].traceCount && (best == -1 || sims[s].trace[pos[s]].start < sims[best].trace[pos[best]].start)) {
+				best = s;
+			}
+		}
+		if (best == -1) {
+			break;
+		}
+
+		const Slice* slice = &sims[best].trace[pos[best]++];
+		char where[32] = "";
+		if (numCpus > 1) {
+			snprintf(where, sizeof(where), "[ cpu %2d ] ", slice->cpu);
+		}
+
+		if (slice->jobId == -1) {
+			printf("  [ time %3d ] %sIdle for %.2f secs\n", slice->start, where, (float) slice->length);
+		} else if (policy == FIFO || policy == SJF) {
+			// FIFO and SJF keep the python version's formatting
+			printf("  [ time %3d ] %sRun job %d for %.2f secs ( DONE at %.2f )\n", slice->start, where, slice->jobId, (float) slice->length, (float) slice->start + (float) slice->length);
+		} else if (slice->done) {
+			printf("  [ time %3d ] %sRun job %3d for %.2f secs ( DONE at %.2f )\n", slice->start, where, slice->jobId, (float) slice->length, (float) slice->start + (float) slice->length);
 		} else {
-			ranFor = job->runtime;
-			printf("  [ time %3d ] Run job %3d for %.2f secs ( DONE at %.2f )\n", theTime, jobId, (float) ranFor, (float) theTime + (float) ranFor);
-			status->turnaround = theTime + ranFor;
-			jobCount--;
+			printf("  [ time %3d ] %sRun job %3d for %.2f secs\n", slice->start, where, slice->jobId, (float) slice->length);
+		}
+	}
+}
+
+// Averages of one run
+struct summary {
+	float response;
+	float turnaround;
+	float wait;
+	int makespan;
+};
+typedef struct summary Summary;
+
+// Response, turnaround and wait are all measured from when the job arrived. Wait is the time spent ready but not
+// running, which is the same as the python version's sum of gaps between slices. This is one pass straight down the
+// arrays the statistics need.
+static Summary summarize(const JobTable* jobs) {
+	Summary sum;
+	memset(&sum, 0, sizeof(sum));
+	for (int i = 0; i < jobs->count; i++) {
+		const int turnaround = jobs->completion[i] - jobs->arrival[i];
+		sum.response += (float) (jobs->firstRun[i] - jobs->arrival[i]);
+		sum.turnaround += (float) turnaround;
+		sum.wait += (float) (turnaround - jobs->runtime[i]);
+		if (jobs->completion[i] > sum.makespan) {
+			sum.makespan = jobs->completion[i];
 		}
-		theTime += ranFor;
-		status->lastRan = theTime;
 	}
+	if (jobs->count > 0) {
+		sum.response /= (float) jobs->count;
+		sum.turnaround /= (float) jobs->count;
+		sum.wait /= (float) jobs->count;
+	}
+	return sum;
+}
+
+static void printJobStatistics(const JobTable* jobs, int id) {
+	const int turnaround = jobs->completion[id] - jobs->arrival[id];
+	printf("  Job %3d -- Response: %3.2f  Turnaround %3.2f  Wait %3.2f\n", id, (float) (jobs->firstRun[id] - jobs->arrival[id]), (float) turnaround, (float) (turnaround - jobs->runtime[id]));
+}
 
-	// Method to clean up job linked list now that it's no longer used
-	dispose(&runList);
+static int finishedAt(const Simulation* sim, int k) {
+	return sim->jobs->completion[sim->finished[k]];
+}
 
+static void printStatistics(const JobTable* jobs, SchedulerPolicy policy, const Simulation* sims, int numSims) {
 	printf("\nFinal statistics:\n");
-	float turnaroundSum = 0.0f;
-	float waitSum = 0.0f;
-	float responseSum = 0.0f;
-	for (const Job* job = *jobs; job; job = job->next) {
-		const JobStatus* status = statuses[job->id];
-		turnaroundSum += (float) status->turnaround;
-		responseSum += (float) status->response;
-		waitSum += (float) status->wait;
-		printf("  Job %3d -- Response: %3.2f  Turnaround %3.2f  Wait %3.2f\n", job->id, (float) status->response, (float) status->turnaround, (float) status->wait);
+
+	// FIFO and SJF list jobs in the order they finished like the python version does, the preemptive policies by id
+	if (policy == FIFO || policy == SJF) {
+		int pos[numSims];
+		memset(pos, 0, sizeof(pos));
+		for (int n = 0; n < jobs->count; n++) {
+			int best = -1;
+			for (int s = 0; s < numSims; s++) {
+				if (pos[s] < sims[s].finishedCount && (best == -1 || finishedAt(&sims[s], pos[s]) < finishedAt(&sims[best], pos[best]))) {
+					best = s;
+				}
+			}
+			const Simulation* sim = &sims[best];
+			printJobStatistics(jobs, sim->jobs->id[sim->finished[pos[best]++]]);
+		}
+	} else {
+		for (int i = 0; i < jobs->count; i++) {
+			printJobStatistics(jobs, i);
+		}
 	}
 
-	printf("\n  Average -- Response: %3.2f  Turnaround %3.2f  Wait %3.2f\n\n", responseSum / (float) totalJobs, turnaroundSum / (float) totalJobs, waitSum / (float) totalJobs);
+	const Summary sum = summarize(jobs);
+	printf("\n  Average -- Response: %3.2f  Turnaround %3.2f  Wait %3.2f\n\n", sum.response, sum.turnaround, sum.wait);
+}
 
-	// Free memory from statuses now that they're no longer used. Only place this struct is used so I didn't bother w/ a function
-	for (int i = 0; i < totalJobs; i++) {
-		free(statuses[i]);
+static void printCpuStatistics(const Cpu* cpus, int numCpus, int makespan) {
+	printf("Per-CPU statistics:\n");
+	for (int c = 0; c < numCpus; c++) {
+		const Cpu* cpu = &cpus[c];
+		const float utilization = makespan > 0 ? 100.0f * (float) cpu->busy / (float) makespan : 0.0f;
+		printf("  CPU %3d -- Busy %3.2f  Utilization %3.2f%%  Completed %d  Steals %d ( %d jobs )\n", c, (float) cpu->busy, utilization, cpu->completed, cpu->steals, cpu->stolen);
 	}
-	free(statuses);
+	printf("\n");
 }
 
-void compute(Job** readyQueue, const Options* opts) {
-	printf("** Solutions **\n\n");
-	switch (opts->policy) {
-		case SJF: {
-			// Sort the queue and assign the readyQueue to the new one
-			Job* sorted = NULL;
-			Job* p;
-			while ((p = pop(readyQueue)) != NULL) {
-				insert_sorted(&sorted, p);
+void compute(JobTable* jobs, Arena* arena, const Options* opts) {
+	if (jobs->count == 0) {
+		printf("** Solutions **\n\n");
+		return;
+	}
+
+	// Everything a run allocates comes after the job table and is thrown away by moving the arena back to here
+	const size_t mark = arena->used;
+
+	if (opts->sweep) {
+		static const SchedulerPolicy policies[] = {FIFO, SJF, RR, STCF};
+		printf("** Sweep **\n\n");
+		for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+			arena_reset(arena, mark);
+			Cpu* cpus = arena_alloc(arena, sizeof(Cpu) * opts->cpus);
+			int numSims;
+			runCpus(arena, jobs, opts, policies[p], cpus, 0, &numSims);
+
+			const Summary sum = summarize(jobs);
+			long busy = 0;
+			for (int c = 0; c < opts->cpus; c++) {
+				busy += cpus[c].busy;
 			}
-			*readyQueue = sorted;
-			// No break to fall through into FIFO case
+			const float utilization = 100.0f * (float) busy / ((float) sum.makespan * (float) opts->cpus);
+			printf("  %-4s -- Response: %3.2f  Turnaround %3.2f  Wait %3.2f  Makespan %d  Utilization %3.2f%%\n", toString(policies[p]), sum.response, sum.turnaround, sum.wait, sum.makespan, sum.makespan > 0 ? utilization : 0.0f);
 		}
-		case FIFO:
-			// This works because it's already sorted when inserted with a SJF policy and not when in FIFO.
-			computeFIFO(readyQueue, opts);
-			break;
-		case RR:
-			computeRR(readyQueue, opts);
-			break;
-		default:
-			fprintf(stderr, "Error: Policy %s is not available.\n", opts->policyString);
-			break;
+		printf("\n");
+		arena_reset(arena, mark);
+		return;
+	}
+
+	printf("** Solutions **\n\n");
+	Cpu* cpus = arena_alloc(arena, sizeof(Cpu) * opts->cpus);
+	int numSims;
+	const Simulation* sims = runCpus(arena, jobs, opts, opts->policy, cpus, 1, &numSims);
+
+	printTrace(opts->policy, sims, numSims, opts->cpus);
+	printStatistics(jobs, opts->policy, sims, numSims);
+	if (opts->cpus > 1) {
+		printCpuStatistics(cpus, opts->cpus, summarize(jobs).makespan);
+	}
+
+	arena_reset(arena, mark);
+}
+
+// END Simulation
+
+// Creates the jobs in id order and prints them. Returns nonzero if the options don't describe a valid workload.
+int createJobs(JobTable* jobs, const Options* opts) {
+	if (opts->arrivalList != NULL && opts->arrivalListLen != jobs->count) {
+		fprintf(stderr, "Error: arrival list has %d entries but there are %d jobs.\n", opts->arrivalListLen, jobs->count);
+		return 1;
 	}
+
+	const Rng runtimes = rng_create((uint64_t) opts->seed, STREAM_RUNTIME);
+	const Rng arrivals = rng_create((uint64_t) opts->seed, STREAM_ARRIVAL);
+	int hasArrivals = 0;
+	int arrival = 0;
+
+	for (int i = 0; i < jobs->count; i++) {
+		jobs->id[i] = i;
+		if (opts->jobList == NULL) {
+			// Same formula as the python version, but the draw only depends on the seed and the job index
+			jobs->runtime[i] = (int) (opts->maxLength * rng_double(&runtimes, (uint64_t) i)) + 1;
+		} else {
+			jobs->runtime[i] = opts->jobList[i];
+		}
+
+		if (opts->arrivalList != NULL) {
+			arrival = opts->arrivalList[i];
+		} else if (opts->jobList == NULL && opts->interarrival > 0 && i > 0) {
+			// Open-loop arrivals: exponential gaps between consecutive jobs, so job 0 always arrives at 0
+			arrival += (int) (-opts->interarrival * log(1.0 - rng_double(&arrivals, (uint64_t) i)));
+		}
+		jobs->arrival[i] = arrival;
+		hasArrivals |= arrival != 0;
+	}
+
+	printf("Here is the job list, with the run time of each job: \n");
+	// Separated printing here to reduce repetition of code. Just has to iterate over the jobs once more.
+	for (int i = 0; i < jobs->count; i++) {
+		if (hasArrivals) {
+			printf("  Job %d ( length = %.1f, arrival = %.1f )\n", i, (float) jobs->runtime[i], (float) jobs->arrival[i]);
+		} else {
+			printf("  Job %d ( length = %.1f )\n", i, (float) jobs->runtime[i]);
+		}
+	}
+	printf("\n\n");
+	return 0;
 }
 
+int main(int argc, char** argv) {
+
+	Options opts;
+	parseArguments(&opts, argc, argv);
+
+	if (opts.help) {
+		printHelp();
+		return 0;
+	}
+
+	if (opts.traceFile != NULL && loadTrace(&opts)) {
+		free(opts.jobList);
+		free(opts.arrivalList);
+		return 1;
+	}
+
+	printArguments(&opts);
+
+	// One block holds the job table plus the largest run we're going to do
+	const int totalJobs = opts.jobList != NULL ? opts.jobListLen : opts.jobs;
+	size_t workspace = 0;
+	if (opts.compute) {
+		static const SchedulerPolicy policies[] = {FIFO, SJF, RR, STCF};
+		for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+			if (opts.sweep || policies[p] == opts.policy) {
+				const size_t bytes = runBytes(&opts, policies[p], totalJobs, !opts.sweep) + ARENA_ROUND(sizeof(Simulation) * opts.cpus);
+				workspace = bytes > workspace ? bytes : workspace;
+			}
+		}
+	}
+
+	Arena arena;
+	JobTable jobs;
+	int status = 0;
+	if (arena_init(&arena, jobTableBytes(totalJobs) + workspace)) {
+		free(opts.jobList);
+		free(opts.arrivalList);
+		return 1;
+	}
+	jobs_init(&jobs, &arena, totalJobs);
+
+	if (createJobs(&jobs, &opts) || (opts.saveTraceFile != NULL && saveTrace(opts.saveTraceFile, &jobs))) {
+		status = 1;
+	} else if (opts.compute) {
+		compute(&jobs, &arena, &opts);
+	} else {
+		printf("Compute the turnaround time, response time, and wait time for each job.\n");
+		printf("When you are done, run this program again, with the same arguments,\n");
+		printf("but with -c, which will thus provide you with the answers. You can use\n");
+		printf("-s <somenumber> or your own job list (-l 10,15,20 for example)\n");
+		printf("to generate different problems for yourself.\n\n");
+	}
+
+	arena_free(&arena);
+
+	// free(NULL) is a no-op so these are fine when the lists weren't given
+	free(opts.jobList);
+	free(opts.arrivalList);
+
+	return status;
+}
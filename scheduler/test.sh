@@ -30,3 +30,89 @@ if [ "$cc" -eq 3 ]; then
 else
   echo "Test failed!"
 fi
+
+echo
+echo "Test: STCF without arrivals matches SJF"
+stcf=$(./cmake-build-debug/scheduler.exe -l 10,12,3 -p STCF -c | grep Average)
+sjf=$(python scheduler.py -l 10,12,3 -p SJF -c | grep Average)
+if [ "$stcf" = "$sjf" ]; then
+  echo "Test passed"
+else
+  echo "Test failed!"
+fi
+
+echo
+echo "Test: one CPU per job"
+avg=$(./cmake-build-debug/scheduler.exe --cpus 3 -l 10,12,10 -c | grep Average)
+if [ "$avg" = "  Average -- Response: 0.00  Turnaround 10.67  Wait 0.00" ]; then
+  echo "Test passed"
+else
+  echo "Test failed!"
+fi
+
+echo
+echo "Test: CSV trace with a header and comments matches the same jobs given with -l and -a"
+printf 'arrival,runtime\n# three jobs\n0,10\n1,12\n\n2,3\r\n' > test_trace.csv
+trace=$(./cmake-build-debug/scheduler.exe --trace test_trace.csv -p STCF -c | grep Average)
+list=$(./cmake-build-debug/scheduler.exe -l 10,12,3 -a 0,1,2 -p STCF -c | grep Average)
+if [ -n "$trace" ] && [ "$trace" = "$list" ]; then
+  echo "Test passed"
+else
+  echo "Test failed!"
+fi
+
+echo
+echo "Test: --save-trace then --trace replays the same jobs"
+./cmake-build-debug/scheduler.exe -s 7 -j 6 -i 3 --save-trace test_trace.bin -p RR -c > /dev/null
+saved=$(./cmake-build-debug/scheduler.exe -s 7 -j 6 -i 3 -p RR -c | grep Average)
+loaded=$(./cmake-build-debug/scheduler.exe --trace test_trace.bin -p RR -c | grep Average)
+if [ -n "$saved" ] && [ "$saved" = "$loaded" ]; then
+  echo "Test passed"
+else
+  echo "Test failed!"
+fi
+
+echo
+echo "Test: bad and negative trace lines are rejected"
+failed=0
+for line in '0,5,junk' '1,3xyz' '-3,4' '2,0' '2,99999999999'; do
+  printf 'arrival,runtime\n%s\n' "$line" > test_trace.csv
+  if ./cmake-build-debug/scheduler.exe --trace test_trace.csv -c > /dev/null 2>&1 || \
+     ! ./cmake-build-debug/scheduler.exe --trace test_trace.csv -c 2>&1 | grep -q "^Error: test_trace.csv:2:"; then
+    echo "  accepted: $line"
+    failed=1
+  fi
+done
+if [ "$failed" -eq 0 ]; then
+  echo "Test passed"
+else
+  echo "Test failed!"
+fi
+rm -f test_trace.csv test_trace.bin
+
+echo
+echo "Test: a seed always gives the same jobs"
+jobs=$(./cmake-build-debug/scheduler.exe -s 42 -j 5 -m 20 -i 4 | grep 'length =' | tr -d '\r')
+expected="  Job 0 ( length = 13.0, arrival = 0.0 )
+  Job 1 ( length = 10.0, arrival = 2.0 )
+  Job 2 ( length = 5.0, arrival = 14.0 )
+  Job 3 ( length = 8.0, arrival = 16.0 )
+  Job 4 ( length = 15.0, arrival = 29.0 )"
+if [ "$jobs" = "$expected" ]; then
+  echo "Test passed"
+else
+  echo "Test failed!"
+fi
+
+echo
+echo "Test: sweep"
+sweep=$(./cmake-build-debug/scheduler.exe -l 10,12,3 -a 0,1,2 --sweep | grep -- ' -- ' | tr -d '\r')
+expected="  FIFO -- Response: 9.67  Turnaround 18.00  Wait 9.67  Makespan 25  Utilization 100.00%
+  SJF  -- Response: 6.67  Turnaround 15.00  Wait 6.67  Makespan 25  Utilization 100.00%
+  RR   -- Response: 0.33  Turnaround 18.00  Wait 9.67  Makespan 25  Utilization 100.00%
+  STCF -- Response: 4.00  Turnaround 13.33  Wait 5.00  Makespan 25  Utilization 100.00%"
+if [ "$sweep" = "$expected" ]; then
+  echo "Test passed"
+else
+  echo "Test failed!"
+fi